@@ -0,0 +1,234 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: binned averages and moments of event-by-event quantities,
+see BinAccumulator.h
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <thread>
+#include <functional>
+#include "BinAccumulator.h"
+
+using namespace std;
+
+BinAccumulator::BinAccumulator(const vector<double>& Bins, long N_cols)
+{
+	if(Bins.size() < 2)
+	{
+		cout << "BinAccumulator: need at least two bin edges! Exit..." << endl;
+		exit(-1);
+	}
+	bins = Bins;
+	n_bins = bins.size() - 1;
+	n_cols = N_cols;
+	count.assign(n_bins, 0.);
+	sums.assign(n_bins*n_cols*3, 0.);
+}
+
+long BinAccumulator::findBin(double key)
+{
+	if(!(key >= bins[0]) || key > bins[n_bins])   //also rejects nan
+		return -1;
+	long lo = 0, hi = n_bins;   //bins[lo] <= key <= bins[hi]
+	while(hi - lo > 1)
+	{
+		long mid = (lo + hi)/2;
+		if(bins[mid] <= key)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+void BinAccumulator::add(double key, const double* values)
+{
+	long bin = findBin(key);
+	if(bin < 0)
+		return;
+	count[bin] += 1.;
+	double* ptr = &sums[bin*n_cols*3];
+	for(long col=0;col<n_cols;col++)
+	{
+		double v2 = values[col]*values[col];
+		ptr[0] += values[col];
+		ptr[1] += v2;
+		ptr[2] += v2*v2;
+		ptr += 3;
+	}
+}
+
+void BinAccumulator::merge(const BinAccumulator& other)
+{
+	if(other.n_bins != n_bins || other.n_cols != n_cols)
+	{
+		cout << "BinAccumulator: cannot merge accumulators of different shape! Exit..." << endl;
+		exit(-1);
+	}
+	for(long bin=0;bin<n_bins;bin++)
+		count[bin] += other.count[bin];
+	for(long k=0;k<(long)sums.size();k++)
+		sums[k] += other.sums[k];
+}
+
+void BinAccumulator::clear()
+{
+	count.assign(n_bins, 0.);
+	sums.assign(n_bins*n_cols*3, 0.);
+}
+
+double BinAccumulator::getMean(long bin, long col, int power)
+{
+	if(count[bin] < 1e-15)
+		return 0.;
+	int idx = (power == 1) ? 0 : ((power == 2) ? 1 : 2);
+	return sum(bin, col, idx)/count[bin];
+}
+
+void BinAccumulator::write(ostream& os)
+{
+	for(long bin=0;bin<n_bins;bin++)
+	{
+		os << scientific << setprecision(10)
+		   << bins[bin] << "  " << bins[bin+1] << "  " << count[bin] << "  "
+		   << count[bin]/(bins[bin+1] - bins[bin]) << "  ";
+		for(long col=0;col<n_cols;col++)
+		{
+			double mean = getMean(bin, col, 1);
+			double mean2 = getMean(bin, col, 2);
+			double mean4 = getMean(bin, col, 4);
+			double four = 2.*mean2*mean2 - mean4;
+			os << mean << "  " << mean2 << "  " << mean4 << "  "
+			   << sqrt(mean2) << "  " << (four > 0. ? pow(four, 0.25) : 0.) << "  ";
+		}
+		os << endl;
+	}
+	os.unsetf(ios::floatfield);
+}
+
+
+void BinAccumulator::saveState(ostream& os)
+{
+	os.write((const char*)&n_bins, sizeof(n_bins));
+	os.write((const char*)&n_cols, sizeof(n_cols));
+	os.write((const char*)&bins[0], bins.size()*sizeof(double));
+	os.write((const char*)&count[0], count.size()*sizeof(double));
+	os.write((const char*)&sums[0], sums.size()*sizeof(double));
+}
+
+bool BinAccumulator::loadState(istream& is)
+{
+	long saved_bins, saved_cols;
+	is.read((char*)&saved_bins, sizeof(saved_bins));
+	is.read((char*)&saved_cols, sizeof(saved_cols));
+	if(!is || saved_bins != n_bins || saved_cols != n_cols)
+		return false;
+	vector<double> saved_edges(bins.size());
+	is.read((char*)&saved_edges[0], saved_edges.size()*sizeof(double));
+	if(!is || saved_edges != bins)
+		return false;
+	is.read((char*)&count[0], count.size()*sizeof(double));
+	is.read((char*)&sums[0], sums.size()*sizeof(double));
+	return (bool)is;
+}
+
+
+//a chunk of rows of a column-major table, used by binColumnsParallel()
+static void binColumnsChunk(const double* data, long n_rows, long n_cols, long col_to_bin,
+	long row_begin, long row_end, BinAccumulator* partial)
+{
+	vector<double> values(n_cols > 1 ? n_cols-1 : 1);
+	for(long row=row_begin;row<row_end;row++)
+	{
+		long k = 0;
+		for(long col=0;col<n_cols;col++)
+			if(col != col_to_bin)
+				values[k++] = data[col*n_rows + row];
+		partial->add(data[col_to_bin*n_rows + row], &values[0]);
+	}
+}
+
+//split rows 0 ~ n_rows-1 over n_threads, one partial accumulator per
+//extra thread, merged into result at the end
+static void binRowsParallel(long n_rows, BinAccumulator* result, int n_threads,
+	function<void(long, long, BinAccumulator*)> chunk)
+{
+	if(n_threads < 1)
+		n_threads = 1;
+	vector<BinAccumulator*> partials(n_threads, (BinAccumulator*)0);
+	vector<thread> workers;
+	for(int t=0;t<n_threads;t++)
+	{
+		long row_begin = n_rows*t/n_threads;
+		long row_end = n_rows*(t+1)/n_threads;
+		if(t == 0)   //the calling thread fills the result directly
+		{
+			partials[t] = result;
+			continue;
+		}
+		partials[t] = new BinAccumulator(*result);
+		partials[t]->clear();
+		workers.push_back(thread(chunk, row_begin, row_end, partials[t]));
+	}
+	chunk(0, n_rows/n_threads, result);
+	for(int t=0;t<(int)workers.size();t++)
+		workers[t].join();
+	for(int t=1;t<n_threads;t++)
+	{
+		result->merge(*partials[t]);
+		delete partials[t];
+	}
+}
+
+void binColumnsParallel(const double* data, long n_rows, long n_cols, long col_to_bin,
+	BinAccumulator* result, int n_threads)
+{
+	binRowsParallel(n_rows, result, n_threads,
+		[=](long row_begin, long row_end, BinAccumulator* partial)
+		{binColumnsChunk(data, n_rows, n_cols, col_to_bin, row_begin, row_end, partial);});
+}
+
+static double summaryKey(const EventSummary& summary, int key)
+{
+	switch(key)
+	{
+	case SUMMARY_KEY_NPART: return summary.npart;
+	case SUMMARY_KEY_NCOLL: return summary.ncoll;
+	case SUMMARY_KEY_B: return summary.b;
+	default: return summary.sd_total;
+	}
+}
+
+void binSummariesParallel(const EventSummary* records, long n_records, int key,
+	BinAccumulator* result, int n_threads)
+{
+	if(result->getColumnCount() != SUMMARY_ORDERS)
+	{
+		cout << "binSummariesParallel: the accumulator needs " << SUMMARY_ORDERS
+		     << " columns, one per eccentricity order! Exit..." << endl;
+		exit(-1);
+	}
+	binRowsParallel(n_records, result, n_threads,
+		[=](long row_begin, long row_end, BinAccumulator* partial)
+		{
+			for(long row=row_begin;row<row_end;row++)
+				partial->add(summaryKey(records[row], key), records[row].ecc);
+		});
+}
+
+bool binSummaryFile(string filename, int key, BinAccumulator* result, int n_threads)
+{
+	vector<EventSummary> records;
+	if(!readEventSummaries(filename, &records))
+		return false;
+	if(!records.empty())
+		binSummariesParallel(&records[0], records.size(), key, result, n_threads);
+	return true;
+}
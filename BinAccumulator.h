@@ -0,0 +1,76 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Group events into bins of one key (Npart, b, total entropy...)
+and accumulate <v>, <v^2> and <v^4> of several columns per bin
+1. add() feeds one event at a time, so the generator can stream into it;
+2. binColumnsParallel() bins a whole table, e.g. from readBlockDataFast(),
+   with one partial accumulator per thread, merged at the end;
+   binSummariesParallel() does the same for EventSummary records in
+   memory (e.g. from readEventSummaries()), binned in Npart, Ncoll, b or
+   the total entropy with the eccentricities as columns, and
+   binSummaryFile() for a data/Summary_A_*.bin file, without going
+   through a text table;
+3. All sums live on the heap, any number of bins and columns is fine;
+4. write() prints one line per bin:
+   bin_min  bin_max  count  dN/dkey  then for each column
+   <v>  <v^2>  <v^4>  v{2}=sqrt(<v^2>)  v{4}=(2<v^2>^2-<v^4>)^(1/4)
+   v{4} is set to 0 when 2<v^2>^2-<v^4> is negative.
+The bin edges are assumed to be increasing, keys outside are skipped.
+*/
+
+#ifndef BinAccumulator_h
+#define BinAccumulator_h
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include "EventSummary.h"
+
+using namespace std;
+
+enum SummaryKey {SUMMARY_KEY_NPART, SUMMARY_KEY_NCOLL, SUMMARY_KEY_B, SUMMARY_KEY_SD_TOTAL};
+
+class BinAccumulator
+{
+protected:
+	vector<double> bins;   //bin edges, size n_bins+1
+	long n_bins, n_cols;
+	vector<double> count;   //events in each bin
+	vector<double> sums;    //per bin and column: sum v, sum v^2, sum v^4
+
+	double& sum(long bin, long col, int power) { return sums[(bin*n_cols + col)*3 + power]; }
+
+public:
+	BinAccumulator(const vector<double>& Bins, long N_cols);
+	~BinAccumulator() {};
+
+	long findBin(double key);   //-1 if the key is out of range
+	void add(double key, const double* values);   //add one event
+	void merge(const BinAccumulator& other);   //add the sums of another accumulator
+	void clear(void);
+
+	long getBinCount() { return n_bins; }
+	long getColumnCount() { return n_cols; }
+	double getCount(long bin) { return count[bin]; }
+	double getMean(long bin, long col, int power=1);   //<v^power>, power = 1, 2 or 4
+
+	void write(ostream& os);
+	void saveState(ostream& os);   //raw sums for a checkpoint
+	bool loadState(istream& is);   //false if the saved shape differs
+};
+
+void binColumnsParallel(const double* data, long n_rows, long n_cols, long col_to_bin,
+	BinAccumulator* result, int n_threads=1);  //data is column-major as from readBlockDataFast,
+	                                           //all columns but col_to_bin are accumulated
+void binSummariesParallel(const EventSummary* records, long n_records, int key,
+	BinAccumulator* result, int n_threads=1);  //key: SummaryKey, the result has
+	                                           //SUMMARY_ORDERS columns, ecc[] of each record
+bool binSummaryFile(string filename, int key, BinAccumulator* result,
+	int n_threads=1);   //same from a summary table, false if it cannot be read
+
+#endif
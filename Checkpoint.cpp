@@ -0,0 +1,131 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: write, read and apply checkpoints of a generation run,
+see Checkpoint.h
+*/
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Checkpoint.h"
+
+using namespace std;
+
+Checkpoint::Checkpoint(string Filename)
+{
+	filename = Filename;
+	run_seed = 0;
+	fixed_seed = false;
+	nevents = 0;
+	shard = 0;
+	n_shards = 1;
+	next_event = 0;
+}
+
+void Checkpoint::addFile(string name, long int size)
+{
+	files.push_back(name);
+	sizes.push_back(size);
+}
+
+void Checkpoint::addFile(string name)
+{
+	struct stat info;
+	addFile(name, stat(name.c_str(), &info) == 0 ? (long int)info.st_size : 0L);
+}
+
+bool Checkpoint::write()
+{
+	string tmp_name = filename + ".tmp";
+	{
+		ofstream of(tmp_name.c_str(), ios::binary);
+		of << "% checkpoint of a MCG run, continue with: main --resume" << endl
+		   << "% run_seed fixed_seed nevents shard n_shards next_event" << endl
+		   << run_seed << " " << fixed_seed << " " << nevents << " "
+		   << shard << " " << n_shards << " " << next_event << endl
+		   << files.size() << endl;
+		for(int k=0;k<(int)files.size();k++)
+			of << sizes[k] << " " << files[k] << endl;
+		of << state.size() << endl;
+		of.write(state.data(), state.size());
+		of.flush();
+		if(!of.good())
+		{
+			cout << "Cannot write checkpoint " << tmp_name << endl;
+			return false;
+		}
+	}
+	if(rename(tmp_name.c_str(), filename.c_str()) != 0)
+	{
+		cout << "Cannot rename " << tmp_name << " to " << filename << endl;
+		return false;
+	}
+	return true;
+}
+
+bool Checkpoint::read()
+{
+	ifstream in(filename.c_str(), ios::binary);
+	if(!in.good())
+		return false;
+	while(in.peek() == '%')
+	{
+		string comment;
+		getline(in, comment);
+	}
+	long int n_files;
+	in >> run_seed >> fixed_seed >> nevents >> shard >> n_shards >> next_event >> n_files;
+	if(!in || n_files < 0)
+		return false;
+	clearFiles();
+	for(long int k=0;k<n_files;k++)
+	{
+		long int size;
+		string name;
+		in >> size;
+		in.get();   //the single space before the name
+		getline(in, name);
+		if(!in)
+			return false;
+		addFile(name, size);
+	}
+	long int n_bytes;
+	in >> n_bytes;
+	in.get();   //end of line
+	if(!in || n_bytes < 0)
+		return false;
+	state.assign(n_bytes, '\0');
+	if(n_bytes > 0)
+		in.read(&state[0], n_bytes);
+	return (bool)in;
+}
+
+bool Checkpoint::truncateFiles()
+{
+	bool ok = true;
+	for(int k=0;k<(int)files.size();k++)
+	{
+		struct stat info;
+		bool exists = (stat(files[k].c_str(), &info) == 0);
+		if(!exists && sizes[k] == 0)
+			continue;   //not created before the checkpoint
+		if(!exists || (long int)info.st_size < sizes[k])
+		{
+			cout << "Output " << files[k] << " is shorter than at the checkpoint" << endl;
+			ok = false;
+		}
+		else if(truncate(files[k].c_str(), sizes[k]) != 0)
+		{
+			cout << "Cannot truncate " << files[k] << endl;
+			ok = false;
+		}
+	}
+	return ok;
+}
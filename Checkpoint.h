@@ -0,0 +1,63 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Checkpoint of a long generation run, so that it can be
+continued with "main --resume" after being killed
+1. A checkpoint is taken between two events and records the run
+   parameters, the next event to generate, the size of every output
+   shared by all events and the raw state of the accumulators;
+2. The random stream of an event only depends on the run seed and the
+   event number (mc_glauber::setEventSeed), so the next event number is
+   the whole RNG position; runs without --seed resume with fresh seeds;
+3. On resume the outputs are cut back to the recorded sizes, which drops
+   whatever was written after the checkpoint, and are then appended to;
+   a run resumed with --seed gives the same files as an uninterrupted run;
+4. The file is written to <filename>.tmp and renamed, so a run killed
+   while checkpointing keeps the previous checkpoint. Layout:
+   % comment lines
+   run_seed  fixed_seed  nevents  shard  n_shards  next_event
+   n_files, then one line per file:  size  name
+   n_bytes of the accumulator state, then the raw bytes
+*/
+
+#ifndef Checkpoint_h
+#define Checkpoint_h
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class Checkpoint
+{
+protected:
+	string filename;
+
+public:
+	unsigned long int run_seed;
+	bool fixed_seed;
+	int nevents, shard, n_shards;
+	int next_event;   //first event not finished yet
+	vector<string> files;   //outputs shared by all events
+	vector<long int> sizes;   //their size in bytes
+	string state;   //accumulators, see BinAccumulator::saveState()
+
+	Checkpoint(string Filename);
+	~Checkpoint() {};
+
+	void clearFiles() { files.clear(); sizes.clear(); }
+	void addFile(string name, long int size);
+	void addFile(string name);   //size taken from the file system
+
+	bool write();   //false if the checkpoint could not be written
+	bool read();    //false if there is no (complete) checkpoint
+	bool truncateFiles();   //cut every output back to its recorded size
+
+	string getFilename() { return filename; }
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: generator threads, slot pool and the rings between them,
+see EventQueue.h
+
+SlotRing is the bounded queue of D. Vyukov: cell k of the ring holds the
+position it may be used for next, pos for a push and pos+1 for a pop;
+head and tail are claimed with a compare-and-swap, the cell is published
+by storing its new sequence number.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include "EventQueue.h"
+
+using namespace std;
+
+//wait a little when a ring is empty or full
+static void backOff(int* spins)
+{
+	if((*spins)++ < 64)
+		this_thread::yield();
+	else
+		this_thread::sleep_for(chrono::microseconds(50));
+}
+
+SlotRing::SlotRing(size_t Capacity)
+{
+	size_t capacity = 2;
+	while(capacity < Capacity)
+		capacity *= 2;
+	cells = new Cell[capacity];
+	for(size_t k=0;k<capacity;k++)
+	{
+		cells[k].sequence.store(k, memory_order_relaxed);
+		cells[k].slot = 0;
+	}
+	mask = capacity-1;
+	head.store(0, memory_order_relaxed);
+	tail.store(0, memory_order_relaxed);
+}
+
+SlotRing::~SlotRing()
+{
+	delete [] cells;
+}
+
+bool SlotRing::push(EventSlot* slot)
+{
+	size_t pos = head.load(memory_order_relaxed);
+	for(;;)
+	{
+		Cell& cell = cells[pos & mask];
+		size_t sequence = cell.sequence.load(memory_order_acquire);
+		intptr_t lag = (intptr_t)sequence - (intptr_t)pos;
+		if(lag == 0)
+		{
+			if(head.compare_exchange_weak(pos, pos+1, memory_order_relaxed))
+			{
+				cell.slot = slot;
+				cell.sequence.store(pos+1, memory_order_release);
+				return true;
+			}
+		}
+		else if(lag < 0)   //the cell still holds an item from the last round
+			return false;
+		else
+			pos = head.load(memory_order_relaxed);
+	}
+}
+
+bool SlotRing::pop(EventSlot** slot)
+{
+	size_t pos = tail.load(memory_order_relaxed);
+	for(;;)
+	{
+		Cell& cell = cells[pos & mask];
+		size_t sequence = cell.sequence.load(memory_order_acquire);
+		intptr_t lag = (intptr_t)sequence - (intptr_t)(pos+1);
+		if(lag == 0)
+		{
+			if(tail.compare_exchange_weak(pos, pos+1, memory_order_relaxed))
+			{
+				*slot = cell.slot;
+				cell.sequence.store(pos+mask+1, memory_order_release);
+				return true;
+			}
+		}
+		else if(lag < 0)   //nothing pushed to this cell yet
+			return false;
+		else
+			pos = tail.load(memory_order_relaxed);
+	}
+}
+
+
+EventQueue::EventQueue(const MCGConfig& Config, long int First_event, long int Last_event,
+	int N_generators, int N_slots, EventHook Hook)
+	: free_slots(N_slots > 0 ? N_slots : 4*N_generators),
+	  ready_slots(N_slots > 0 ? N_slots : 4*N_generators)
+{
+	config = Config;
+	first_event = First_event;
+	last_event = Last_event;
+	hook = Hook;
+	if(N_generators < 1)
+		N_generators = 1;
+	if(N_slots <= 0)
+		N_slots = 4*N_generators;
+
+	//all grids are allocated here, once
+	int grid_size = (int)((config.sd_tbl_max-config.sd_tbl_min)/config.sd_tbl_step+0.1)+1;
+	for(int k=0;k<N_slots;k++)
+	{
+		EventSlot* slot = new EventSlot;
+		slot->event_id = 0;
+		if(config.deposit_entropy)
+			slot->grid.resize(grid_size, grid_size,
+				config.sd_tbl_min, config.sd_tbl_min, config.sd_tbl_step);
+		slots.push_back(slot);
+		free_slots.push(slot);
+	}
+	early.assign(N_slots, (EventSlot*)0);
+
+	next_in.store(first_event);
+	n_taken.store(0);
+	stopping.store(false);
+	next_out = first_event;
+	for(int k=0;k<N_generators;k++)
+		generators.push_back(thread(&EventQueue::generatorLoop, this));
+}
+
+EventQueue::~EventQueue()
+{
+	stopping.store(true);
+	for(int k=0;k<(int)generators.size();k++)
+		generators[k].join();
+	for(int k=0;k<(int)slots.size();k++)
+		delete slots[k];
+}
+
+void EventQueue::generatorLoop()
+{
+	MCGenerator generator(config);
+	for(;;)
+	{
+		//a slot first, then the event number: every event that is
+		//handed out has its slot, so next() cannot run out of them
+		EventSlot* slot = 0;
+		for(int spins=0;!free_slots.pop(&slot);)
+		{
+			if(stopping.load())
+				return;
+			backOff(&spins);
+		}
+		long int event = next_in++;
+		if(event > last_event || stopping.load())
+		{
+			free_slots.push(slot);
+			return;
+		}
+
+		slot->event_id = event;
+		if(config.deposit_entropy)
+			generator.generate(event, &slot->summary, slot->grid.getData(), slot->grid.size());
+		else
+			generator.generate(event, &slot->summary);
+		if(hook)
+			hook(generator.getGlauber(), slot);
+		ready_slots.push(slot);   //holds all slots, never full
+	}
+}
+
+EventSlot* EventQueue::next()
+{
+	if(next_out > last_event)
+		return 0;
+	int n_slots = slots.size();
+	for(int spins=0;;)
+	{
+		EventSlot*& waiting = early[next_out % n_slots];
+		if(waiting)
+		{
+			EventSlot* slot = waiting;
+			waiting = 0;
+			next_out++;
+			return slot;
+		}
+		EventSlot* slot;
+		if(ready_slots.pop(&slot))
+		{
+			//events in flight lie within N_slots of next_out
+			early[slot->event_id % n_slots] = slot;
+			spins = 0;
+		}
+		else
+			backOff(&spins);
+	}
+}
+
+EventSlot* EventQueue::take()
+{
+	if(n_taken++ >= last_event-first_event+1)
+		return 0;
+	EventSlot* slot;
+	for(int spins=0;!ready_slots.pop(&slot);)
+		backOff(&spins);
+	return slot;
+}
+
+void EventQueue::release(EventSlot* slot)
+{
+	free_slots.push(slot);   //holds all slots, never full
+}
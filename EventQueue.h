@@ -0,0 +1,107 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Pipeline of ready events from generator threads to consumers
+1. EventQueue starts N_generators threads, each with its own MCGenerator;
+   they take event numbers First_event ~ Last_event one by one and fill
+   them into slots of a pool of N_slots pre-allocated EventSlots (grid
+   included), so no table is allocated once the queue runs;
+2. The hook, if given, runs in the generator thread right after the
+   event, with the mc_glauber of that event: formatting outputs there
+   (into slot->text) takes it off the consumer;
+3. The consumer takes the events with next(), in increasing event number
+   whatever thread finished them first, and gives each slot back with
+   release() when done; take() instead hands out the events in the order
+   they are ready and may be called from several consumer threads; one
+   queue is read with either next() or take(), not both;
+4. Free and ready slots travel through two bounded lock-free rings
+   (SlotRing, a sequence number per cell); a thread that finds its ring
+   empty yields, then sleeps for short intervals;
+5. With a fixed seed the events are the same as with MCGenerator alone,
+   for any number of generator threads.
+*/
+
+#ifndef EventQueue_h
+#define EventQueue_h
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include "MCGenerator.h"
+
+using namespace std;
+
+struct EventSlot
+{
+	long int event_id;
+	EventSummary summary;
+	SdTable grid;   //entropy density of the event, empty without deposit_entropy
+	vector<string> text;   //free for the hook, e.g. formatted outputs
+};
+
+//bounded multi-producer multi-consumer ring of slot pointers
+class SlotRing
+{
+protected:
+	struct Cell
+	{
+		atomic<size_t> sequence;   //position the cell is ready for
+		EventSlot* slot;
+	};
+	Cell* cells;
+	size_t mask;   //capacity-1, capacity a power of 2
+	alignas(64) atomic<size_t> head;   //next position to push to
+	alignas(64) atomic<size_t> tail;   //next position to pop from
+
+public:
+	SlotRing(size_t Capacity);
+	~SlotRing();
+
+	bool push(EventSlot* slot);   //false if full
+	bool pop(EventSlot** slot);   //false if empty
+
+private:
+	SlotRing(const SlotRing&);
+	SlotRing& operator=(const SlotRing&);
+};
+
+typedef function<void(mc_glauber*, EventSlot*)> EventHook;
+
+class EventQueue
+{
+protected:
+	MCGConfig config;
+	long int first_event, last_event;
+	vector<EventSlot*> slots;
+	SlotRing free_slots, ready_slots;
+	EventHook hook;
+	atomic<long int> next_in;   //next event number to generate
+	atomic<long int> n_taken;   //events handed out by take()
+	atomic<bool> stopping;
+	long int next_out;   //next event number of next()
+	vector<EventSlot*> early;   //finished before next_out, by event number modulo N_slots
+	vector<thread> generators;
+
+	void generatorLoop();   //body of a generator thread
+
+public:
+	EventQueue(const MCGConfig& Config, long int First_event, long int Last_event,
+		int N_generators=1, int N_slots=0, EventHook Hook=EventHook());   //N_slots=0: 4 per generator
+	~EventQueue();   //stops the generators, events not taken are dropped
+
+	EventSlot* next();   //next event in order, waits for it; 0 after Last_event
+	EventSlot* take();   //any ready event, waits for one; 0 when all are taken
+	void release(EventSlot* slot);   //give the slot back to the pool
+
+private:
+	EventQueue(const EventQueue&);
+	EventQueue& operator=(const EventQueue&);
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: pack, read and print the per-event summary table,
+see EventSummary.h for the file layout
+*/
+
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+#include <stdint.h>
+#include "EventSummary.h"
+
+using namespace std;
+
+static const char summary_magic[8] = {'M','C','G','S','U','M','1','\0'};
+static const int32_t summary_record_size = 8 + 8 + 4 + 4 + 4*8 + 2*SUMMARY_ORDERS*8;
+
+template<class T> static void packValue(string& buffer, T value)
+{
+	buffer.append((const char*)&value, sizeof(T));
+}
+
+template<class T> static T unpackValue(const char*& ptr)
+{
+	T value;
+	memcpy(&value, ptr, sizeof(T));
+	ptr += sizeof(T);
+	return value;
+}
+
+string eventSummaryHeader()
+{
+	string buffer(summary_magic, 8);
+	packValue<int32_t>(buffer, summary_record_size);
+	packValue<int32_t>(buffer, SUMMARY_ORDERS);
+	return buffer;
+}
+
+string packEventSummary(const EventSummary& summary)
+{
+	string buffer;
+	buffer.reserve(summary_record_size);
+	packValue<int64_t>(buffer, summary.event_id);
+	packValue<double>(buffer, summary.b);
+	packValue<int32_t>(buffer, summary.npart);
+	packValue<int32_t>(buffer, summary.ncoll);
+	packValue<double>(buffer, summary.x_cm);
+	packValue<double>(buffer, summary.y_cm);
+	packValue<double>(buffer, summary.sd_total);
+	packValue<double>(buffer, summary.r2);
+	for(int n=0;n<SUMMARY_ORDERS;n++)
+		packValue<double>(buffer, summary.ecc[n]);
+	for(int n=0;n<SUMMARY_ORDERS;n++)
+		packValue<double>(buffer, summary.psi[n]);
+	return buffer;
+}
+
+bool readEventSummaries(string filename, vector<EventSummary>* records)
+{
+	ifstream is(filename.c_str(), ios::in | ios::binary);
+	string header(16, '\0');
+	if(!is.read(&header[0], 16) || memcmp(header.data(), summary_magic, 8) != 0)
+	{
+		cout << "readEventSummaries: " << filename << " is not a summary table" << endl;
+		return false;
+	}
+	const char* ptr = header.data() + 8;
+	int32_t record_size = unpackValue<int32_t>(ptr);
+	int32_t orders = unpackValue<int32_t>(ptr);
+	if(record_size != summary_record_size || orders != SUMMARY_ORDERS)
+	{
+		cout << "readEventSummaries: " << filename
+		     << " was written with a different schema" << endl;
+		return false;
+	}
+
+	string buffer(record_size, '\0');
+	while(is.read(&buffer[0], record_size))
+	{
+		EventSummary summary;
+		ptr = buffer.data();
+		summary.event_id = unpackValue<int64_t>(ptr);
+		summary.b = unpackValue<double>(ptr);
+		summary.npart = unpackValue<int32_t>(ptr);
+		summary.ncoll = unpackValue<int32_t>(ptr);
+		summary.x_cm = unpackValue<double>(ptr);
+		summary.y_cm = unpackValue<double>(ptr);
+		summary.sd_total = unpackValue<double>(ptr);
+		summary.r2 = unpackValue<double>(ptr);
+		for(int n=0;n<SUMMARY_ORDERS;n++)
+			summary.ecc[n] = unpackValue<double>(ptr);
+		for(int n=0;n<SUMMARY_ORDERS;n++)
+			summary.psi[n] = unpackValue<double>(ptr);
+		records->push_back(summary);
+	}
+	return true;
+}
+
+void printEventSummary(ostream& os, const EventSummary& summary)
+{
+	os << setw(10) << summary.event_id
+	   << setw(10) << setprecision(5) << summary.b
+	   << setw(6) << summary.npart
+	   << setw(6) << summary.ncoll
+	   << setw(15) << setprecision(8) << summary.x_cm
+	   << setw(15) << setprecision(8) << summary.y_cm
+	   << setw(15) << setprecision(8) << summary.sd_total
+	   << setw(15) << setprecision(8) << summary.r2;
+	for(int n=0;n<SUMMARY_ORDERS;n++)
+		os << setw(15) << setprecision(8) << summary.ecc[n]
+		   << setw(15) << setprecision(8) << summary.psi[n];
+	os << endl;
+}
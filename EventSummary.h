@@ -0,0 +1,48 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Fixed-schema record of one event, stored in a binary table
+1. mc_glauber::fillEventSummary() fills everything except event_id;
+2. File layout (little endian, as written by the host):
+   header: 8 bytes "MCGSUM1\0", int32 record size in bytes,
+           int32 number of eccentricity orders (SUMMARY_ORDERS)
+   records: int64 event_id, float64 b, int32 npart, int32 ncoll,
+            float64 x_cm, y_cm, sd_total, r2,
+            float64 ecc[SUMMARY_ORDERS], psi[SUMMARY_ORDERS]
+3. ecc[k] and psi[k] hold order n=k+2; r2 is <r^2> around (x_cm, y_cm)
+   weighted by the entropy density.
+*/
+
+#ifndef EventSummary_h
+#define EventSummary_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+#define SUMMARY_ORDERS 4   //eccentricities at order 2,3,4,5
+
+struct EventSummary
+{
+	long int event_id;
+	double b;          //impact parameter
+	int npart, ncoll;  //wounded nucleons and binary collisions
+	double x_cm, y_cm;   //center of the entropy density
+	double sd_total;   //\int dxdy sd
+	double r2;         //<r^2> around the center
+	double ecc[SUMMARY_ORDERS];
+	double psi[SUMMARY_ORDERS];
+};
+
+string eventSummaryHeader();   //bytes that open a summary file
+string packEventSummary(const EventSummary& summary);   //one binary record
+bool readEventSummaries(string filename, vector<EventSummary>* records);  //false if the file is not a summary table
+void printEventSummary(ostream& os, const EventSummary& summary);   //one text line
+
+#endif
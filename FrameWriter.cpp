@@ -0,0 +1,198 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: background frame writer with optional gzip compression,
+see FrameWriter.h
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <zlib.h>
+#include "FrameWriter.h"
+#include "Instrument.h"
+
+using namespace std;
+
+//a frame that does not reach the disk would leave the index and the
+//checkpoints pointing at missing data, so the run stops here
+static void writeFailed(const string& name)
+{
+	cout << "Cannot write " << name << ", disk full? Exit..." << endl;
+	exit(-1);
+}
+
+FrameWriter::FrameWriter(string Filename, bool Compress, bool Append,
+	int Level, size_t Max_pending)
+{
+	filename = Filename;
+	compress = Compress;
+	level = Level;
+	max_pending = Max_pending;
+	closing = false;
+	n_frames = 0;
+	n_written = 0;
+	n_stored = 0;
+
+	out = fopen(filename.c_str(), Append ? "ab" : "wb");
+	if(out == 0)
+	{
+		cout << "Cannot open output file: " << filename << "! Exit..." << endl;
+		exit(-1);
+	}
+	fseek(out, 0, SEEK_END);   //offsets in the index are absolute
+	idx = 0;
+	if(compress)  //plain text does not need an index to be split
+	{
+		string idx_name = filename + ".idx";
+		if(Append)  //continue the frame numbers of the existing index
+		{
+			FILE* old_idx = fopen(idx_name.c_str(), "r");
+			if(old_idx)
+			{
+				int c;
+				while((c = fgetc(old_idx)) != EOF)
+					if(c == '\n')
+						n_stored++;
+				fclose(old_idx);
+			}
+		}
+		idx = fopen(idx_name.c_str(), Append ? "a" : "w");
+		if(idx == 0)
+		{
+			cout << "Cannot open index file: " << idx_name << "! Exit..." << endl;
+			exit(-1);
+		}
+		fseek(idx, 0, SEEK_END);
+	}
+
+	worker = thread(&FrameWriter::writerLoop, this);
+}
+
+FrameWriter::~FrameWriter()
+{
+	close();
+}
+
+void FrameWriter::endFrame()
+{
+	if(pending.empty())
+		return;
+	unique_lock<mutex> lock(queue_lock);
+	{
+		MCG_TIMER(TMR_WAIT);   //generator blocked by a full queue
+		queue_cond.wait(lock, [this]{ return queue.size() < max_pending; });
+	}
+	queue.push_back(string());
+	queue.back().swap(pending);   //no copy of the frame
+	n_frames++;
+	queue_cond.notify_all();
+}
+
+long int FrameWriter::sync(long int* idx_size)
+{
+	endFrame();
+	unique_lock<mutex> lock(queue_lock);
+	queue_cond.wait(lock, [this]{ return n_written == n_frames; });
+	//the writer thread is idle now, until the next endFrame()
+	if(fflush(out) != 0)
+		writeFailed(filename);
+	long int size = ftell(out);
+	if(idx && fflush(idx) != 0)
+		writeFailed(filename + ".idx");
+	if(idx_size)
+		*idx_size = idx ? ftell(idx) : 0;
+	return size;
+}
+
+void FrameWriter::close()
+{
+	if(out == 0)   //already closed
+		return;
+	endFrame();
+	{
+		lock_guard<mutex> lock(queue_lock);
+		closing = true;
+	}
+	queue_cond.notify_all();
+	worker.join();
+
+	if(fclose(out) != 0)
+		writeFailed(filename);
+	out = 0;
+	if(idx)
+	{
+		if(fclose(idx) != 0)
+			writeFailed(filename + ".idx");
+		idx = 0;
+	}
+}
+
+void FrameWriter::writerLoop()
+{
+	while(true)
+	{
+		string frame;
+		{
+			unique_lock<mutex> lock(queue_lock);
+			queue_cond.wait(lock, [this]{ return closing || !queue.empty(); });
+			if(queue.empty())   //closing and nothing left
+				return;
+			frame.swap(queue.front());
+			queue.pop_front();
+		}
+		queue_cond.notify_all();   //wake up a blocked endFrame()
+		storeFrame(frame);
+		{
+			lock_guard<mutex> lock(queue_lock);
+			n_written++;
+		}
+		queue_cond.notify_all();   //wake up a waiting sync()
+	}
+}
+
+void FrameWriter::storeFrame(const string& frame)
+{
+	MCG_TIMER(TMR_OUTPUT);
+	if(!compress)
+	{
+		if(fwrite(frame.data(), 1, frame.size(), out) != frame.size())
+			writeFailed(filename);
+		MCG_COUNT(CNT_BYTES_WRITTEN, (long int)frame.size());
+		return;
+	}
+
+	//one complete gzip member per frame
+	z_stream zs;
+	zs.zalloc = Z_NULL;
+	zs.zfree = Z_NULL;
+	zs.opaque = Z_NULL;
+	if(deflateInit2(&zs, level, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		cout << "FrameWriter: cannot initialize zlib! Exit..." << endl;
+		exit(-1);
+	}
+	string packed(deflateBound(&zs, frame.size()), '\0');
+	zs.next_in = (Bytef*)frame.data();
+	zs.avail_in = frame.size();
+	zs.next_out = (Bytef*)&packed[0];
+	zs.avail_out = packed.size();
+	int status = deflate(&zs, Z_FINISH);
+	long int packed_size = packed.size() - zs.avail_out;
+	deflateEnd(&zs);
+	if(status != Z_STREAM_END)
+	{
+		cout << "FrameWriter: compression of a frame failed! Exit..." << endl;
+		exit(-1);
+	}
+
+	long int offset = ftell(out);
+	if(fwrite(packed.data(), 1, packed_size, out) != (size_t)packed_size)
+		writeFailed(filename);
+	MCG_COUNT(CNT_BYTES_WRITTEN, packed_size);
+	if(fprintf(idx, "%ld %ld %ld %ld\n", n_stored++, offset, packed_size, (long int)frame.size()) < 0)
+		writeFailed(filename + ".idx");
+}
@@ -0,0 +1,84 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Write output files in frames from a background thread
+1. The generator fills a frame with write() and hands it over with
+   endFrame(); formatting stays in the generator, compression and disk
+   access happen in the writer thread;
+2. With compression on, every frame becomes an independent gzip member,
+   so the file is still read by zcat/gunzip, while one event can be
+   extracted alone by seeking to its member;
+3. The offset of each frame is written to <filename>.idx:
+   frame_id  offset  stored_bytes  raw_bytes
+4. At most max_pending frames wait in the queue, endFrame() blocks when
+   the writer falls behind, so memory stays bounded;
+5. sync() ends the current frame and returns the file size once all
+   frames are on disk; with Append=true a file cut back to that size
+   continues seamlessly, which is how runs resume from a checkpoint. A
+   frame cannot stay open across a sync(), so the caller takes them on
+   its frame boundaries if the frames are to stay regular (main rounds
+   checkpoint_every up to a multiple of ecc_frame_events);
+6. A failed write or close stops the program with a message, frames are
+   never dropped silently.
+*/
+
+#ifndef FrameWriter_h
+#define FrameWriter_h
+
+#include <cstdio>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+class FrameWriter
+{
+protected:
+	string filename;
+	bool compress;    //gzip every frame
+	int level;        //zlib compression level, 1(fast) ~ 9(small)
+	FILE* out;        //data file
+	FILE* idx;        //frame index file
+	long int n_frames;   //frames handed over so far
+	long int n_written;  //frames finished by the writer thread
+	long int n_stored;   //frame number of the next entry in the index
+
+	string pending;   //frame being filled by the generator
+	deque<string> queue;   //frames waiting for the writer thread
+	size_t max_pending;
+	bool closing;
+	mutex queue_lock;
+	condition_variable queue_cond;
+	thread worker;
+
+	void writerLoop();   //body of the writer thread
+	void storeFrame(const string& frame);   //compress and write one frame
+
+public:
+	FrameWriter(string Filename, bool Compress=true, bool Append=false,
+		int Level=6, size_t Max_pending=64);
+	~FrameWriter();
+
+	void write(const string& data) { pending += data; }   //add to the current frame
+	void endFrame();   //hand the current frame to the writer thread
+	long int sync(long int* idx_size=0);   //end the frame, wait until every frame is on disk,
+	                   //return the file size (and the index size) for a checkpoint
+	void close();      //flush all frames and stop the writer thread
+
+	string getFilename() { return filename; }
+	bool isCompressed() { return compress; }
+	long int getFrameCount() { return n_frames; }
+
+private:
+	FrameWriter(const FrameWriter&);
+	FrameWriter& operator=(const FrameWriter&);
+};
+
+#endif
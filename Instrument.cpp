@@ -0,0 +1,133 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: thread-local counter blocks and their report, see Instrument.h
+*/
+
+#include <iomanip>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "Instrument.h"
+
+using namespace std;
+
+static const char* counter_names[N_COUNTERS] = {"events", "pair_tests", "hits",
+	"cells", "bytes_written", "rng_draws"};
+static const char* timer_names[N_TIMERS] = {"sampling", "collision", "deposit",
+	"moments", "format", "output", "wait"};
+
+#ifdef MCG_INSTRUMENT
+
+//a whole number of cache lines, also when allocated (aligned new), so no
+//two threads share a line
+struct alignas(64) InstrumentBlock
+{
+	atomic<long int> counters[N_COUNTERS];
+	atomic<long int> timer_ns[N_TIMERS];
+	atomic<long int> timer_calls[N_TIMERS];
+};
+
+static mutex registry_lock;
+static vector<InstrumentBlock*> registry;   //blocks of all threads, never freed
+static chrono::steady_clock::time_point instrument_start = chrono::steady_clock::now();
+
+static InstrumentBlock* localBlock()
+{
+	static thread_local InstrumentBlock* block = 0;
+	if(block == 0)   //first use in this thread
+	{
+		block = new InstrumentBlock;
+		for(int k=0;k<N_COUNTERS;k++)
+			block->counters[k] = 0;
+		for(int k=0;k<N_TIMERS;k++)
+		{
+			block->timer_ns[k] = 0;
+			block->timer_calls[k] = 0;
+		}
+		lock_guard<mutex> lock(registry_lock);
+		registry.push_back(block);
+	}
+	return block;
+}
+
+void instrumentCount(int counter, long int n)
+{
+	localBlock()->counters[counter].fetch_add(n, memory_order_relaxed);
+}
+
+void instrumentTime(int timer, long int ns)
+{
+	InstrumentBlock* block = localBlock();
+	block->timer_ns[timer].fetch_add(ns, memory_order_relaxed);
+	block->timer_calls[timer].fetch_add(1, memory_order_relaxed);
+}
+
+void instrumentReport(ostream& os, bool json)
+{
+	long int counters[N_COUNTERS] = {0};
+	long int timer_ns[N_TIMERS] = {0};
+	long int timer_calls[N_TIMERS] = {0};
+	{
+		lock_guard<mutex> lock(registry_lock);
+		for(int t=0;t<(int)registry.size();t++)
+		{
+			for(int k=0;k<N_COUNTERS;k++)
+				counters[k] += registry[t]->counters[k].load(memory_order_relaxed);
+			for(int k=0;k<N_TIMERS;k++)
+			{
+				timer_ns[k] += registry[t]->timer_ns[k].load(memory_order_relaxed);
+				timer_calls[k] += registry[t]->timer_calls[k].load(memory_order_relaxed);
+			}
+		}
+	}
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - instrument_start).count();
+
+	if(json)
+	{
+		os << "{\"elapsed_s\":" << setprecision(6) << elapsed << ",\"counters\":{";
+		for(int k=0;k<N_COUNTERS;k++)
+			os << (k ? "," : "") << "\"" << counter_names[k] << "\":" << counters[k];
+		os << "},\"timers\":{";
+		for(int k=0;k<N_TIMERS;k++)
+			os << (k ? "," : "") << "\"" << timer_names[k] << "\":{\"calls\":" << timer_calls[k]
+			   << ",\"s\":" << setprecision(6) << timer_ns[k]*1e-9 << "}";
+		os << "}}" << endl;
+	}
+	else   //CSV: elapsed_s, counters..., timers in seconds..., see instrumentCsvHeader()
+	{
+		os << setprecision(6) << elapsed;
+		for(int k=0;k<N_COUNTERS;k++)
+			os << "," << counters[k];
+		for(int k=0;k<N_TIMERS;k++)
+			os << "," << setprecision(6) << timer_ns[k]*1e-9;
+		os << endl;
+	}
+}
+
+#else
+
+void instrumentReport(ostream& os, bool json)
+{
+	if(json)
+		os << "{\"instrument\":\"disabled, compile with -DMCG_INSTRUMENT\"}" << endl;
+	else
+		os << "% instrument disabled, compile with -DMCG_INSTRUMENT" << endl;
+}
+
+#endif
+
+void instrumentCsvHeader(ostream& os)
+{
+	os << "elapsed_s";
+	for(int k=0;k<N_COUNTERS;k++)
+		os << "," << counter_names[k];
+	for(int k=0;k<N_TIMERS;k++)
+		os << "," << timer_names[k] << "_s";
+	os << endl;
+}
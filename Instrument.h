@@ -0,0 +1,74 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Live counters and stage timers for production runs
+1. Compiled in only with -DMCG_INSTRUMENT, otherwise MCG_COUNT and
+   MCG_TIMER expand to nothing;
+2. Every thread adds to its own block of counters, the blocks are only
+   summed when instrumentReport() is called; a block is aligned to and
+   padded to whole cache lines, so the hot path never shares a cache
+   line with another thread;
+3. Counters are added in bulk (once per loop, not once per pair) and
+   timers wrap whole stages, which keeps the overhead far below 1%;
+4. The output timer measures the writer thread, the wait timer measures
+   how long the generator was blocked by a full output queue: a job with
+   a large wait time is I/O-bound.
+*/
+
+#ifndef Instrument_h
+#define Instrument_h
+
+#include <iostream>
+
+using namespace std;
+
+enum InstrumentCounter {
+	CNT_EVENTS, CNT_PAIR_TESTS, CNT_HITS, CNT_CELLS, CNT_BYTES_WRITTEN,
+	CNT_RNG_DRAWS, N_COUNTERS
+};
+
+enum InstrumentTimer {
+	TMR_SAMPLING, TMR_COLLISION, TMR_DEPOSIT, TMR_MOMENTS, TMR_FORMAT,
+	TMR_OUTPUT, TMR_WAIT, N_TIMERS
+};
+
+#ifdef MCG_INSTRUMENT
+
+#include <chrono>
+
+void instrumentCount(int counter, long int n);   //add to this thread's counter
+void instrumentTime(int timer, long int ns);     //add to this thread's timer
+
+class ScopedTimer
+{
+protected:
+	int timer;
+	chrono::steady_clock::time_point start;
+public:
+	ScopedTimer(int Timer) { timer = Timer; start = chrono::steady_clock::now(); }
+	~ScopedTimer() {
+		instrumentTime(timer, chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now() - start).count());
+	}
+};
+
+#define MCG_COUNT(counter, n) instrumentCount(counter, n)
+#define MCG_TIMER(timer) ScopedTimer mcg_scoped_timer_##timer(timer)
+inline bool instrumentEnabled() { return true; }
+
+#else
+
+#define MCG_COUNT(counter, n) ((void)0)
+#define MCG_TIMER(timer) ((void)0)
+inline bool instrumentEnabled() { return false; }
+
+#endif
+
+void instrumentReport(ostream& os, bool json=true);   //sum of all threads, one line
+void instrumentCsvHeader(ostream& os);   //column names of the CSV lines (json=false)
+
+#endif
@@ -0,0 +1,69 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: in-memory interface of the generator, see MCGenerator.h
+*/
+
+#include <iostream>
+#include "MCGenerator.h"
+
+using namespace std;
+
+unsigned long int mcgEventSeed(unsigned long int run_seed, long int event)
+{
+	return run_seed*1099511628211UL + (unsigned long int)event;
+}
+
+MCGenerator::MCGenerator(const MCGConfig& Config)
+{
+	config = Config;
+	glauber_sim = new mc_glauber(config.atom_num, config.impact_parameter,
+		config.sd_tbl_min, config.sd_tbl_max, config.sd_tbl_step, config.atom_num2,
+		config.verbose);
+	glauber_sim->setSpecies(config.species, config.species2);
+	glauber_sim->setCollisionProfile(config.collision_profile, config.collision_opacity);
+	glauber_sim->setHotSpots(config.hot_spots);
+	glauber_sim->setWeightFluctuations(config.weight_shape);
+	glauber_sim->setNormalization(config.normalization);
+	glauber_sim->setDepositEntropy(config.deposit_entropy);
+	glauber_sim->setAlignment(config.align_order);
+	glauber_sim->setLongitudinalProfile(config.y_beam, config.eta_plateau, config.eta_width);
+	grid_size = (int)((config.sd_tbl_max-config.sd_tbl_min)/config.sd_tbl_step+0.1)+1;
+	attached = 0;
+}
+
+MCGenerator::~MCGenerator()
+{
+	delete glauber_sim;   //an attached buffer stays with the caller
+}
+
+bool MCGenerator::generate(long int event, EventSummary* summary,
+	sd_real* buffer, long int buffer_size)
+{
+	if(buffer && buffer_size < getGridCells())
+		return false;
+	if(buffer != attached)
+	{
+		glauber_sim->setSdBuffer(buffer, buffer_size);
+		attached = buffer;
+	}
+
+	if(config.fixed_seed)
+		glauber_sim->setEventSeed(mcgEventSeed(config.run_seed, event));
+	glauber_sim->overlap();
+	if(summary)
+	{
+		summary->event_id = event;
+		glauber_sim->fillEventSummary(summary);
+	}
+	return true;
+}
+
+void MCGenerator::fillSourceList(SourceList* sources)
+{
+	glauber_sim->fillSourceList(sources);
+}
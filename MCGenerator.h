@@ -0,0 +1,120 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: In-memory interface of the generator, for codes (e.g. hydro)
+that link libmcglauber.a or libmcglauber.so instead of reading files
+1. Fill an MCGConfig once and construct an MCGenerator from it; the
+   nuclei and the table buffer are set up once and reused by every
+   event, the CDF tables of the nuclei once per process;
+2. generate(k, &summary) produces event k, the same event as number k
+   of "main --seed run_seed" with the same switches, independent of the
+   order in which events are asked for; the summary is filled as in
+   data/Summary_A_*.bin (event_id = k);
+3. getSdTable() is a view of the entropy density table of the last
+   event: one contiguous row-major block, see SdTable.h, valid until the
+   next generate(); nothing is copied and nothing goes to disk;
+4. generate(k, &summary, buffer, n) deposits the event directly into the
+   caller's array of n >= getGridCells() cells (row-major, cell (i,j) at
+   buffer[i*getGridSize()+j]); it returns false if the array is too small;
+5. With verbose=true the generator prints its progress to cout, with
+   verbose=false (the default) only errors and warnings; cout itself is
+   left alone, so the host code prints as usual;
+6. Generators are independent, one per thread runs in parallel, see
+   EventQueue.h for a pipeline of generator threads.
+
+Usage:
+	MCGConfig config;
+	config.atom_num = 208;
+	config.impact_parameter = 8.;
+	config.run_seed = 7;
+	MCGenerator generator(config);
+	vector<sd_real> sd(generator.getGridCells());
+	EventSummary summary;
+	for(long int k=1;k<=n;k++)
+		if(generator.generate(k, &summary, &sd[0], sd.size()))
+			... sd[i*generator.getGridSize()+j] at x_i, y_j = getGridLower()+(i,j)*getGridStep() ...
+*/
+
+#ifndef MCGenerator_h
+#define MCGenerator_h
+
+#include <iostream>
+#include "mc_glauber.h"
+
+using namespace std;
+
+//seed of event k (counting from 1) of a run, shared with main
+unsigned long int mcgEventSeed(unsigned long int run_seed, long int event);
+
+struct MCGConfig
+{
+	int atom_num, atom_num2;   //atom_num2=0: both nuclei have atom_num
+	double impact_parameter;
+	double sd_tbl_min, sd_tbl_max, sd_tbl_step;   //grid in x and y
+	unsigned long int run_seed;
+	bool fixed_seed;   //false: every event is seeded from /dev/urandom
+	int collision_profile;   //CollisionProfile
+	double collision_opacity;
+	int hot_spots;   //constituents per nucleon, 0: none
+	double weight_shape;   //gamma shape k of the source weights, 0: fixed
+	Normalization* normalization;   //0: unnormalised, not owned
+	bool deposit_entropy;   //false: no table, moments from the sources
+	int align_order;   //>0: recentred and rotated by Psi_n before deposition
+	string species, species2;   //"": R = 1.25 A^1/3 fm, else e.g. "U238", see NuclearData.h
+	double y_beam, eta_plateau, eta_width;   //eta_s profile, see mc_glauber::dumpSd3D()
+	bool verbose;   //false: errors and warnings only, see mc_glauber::setVerbose()
+
+	MCGConfig()   //same defaults as main
+	{
+		atom_num = 208; atom_num2 = 0;
+		impact_parameter = 6.;
+		sd_tbl_min = -13.; sd_tbl_max = 13.; sd_tbl_step = 0.1;
+		run_seed = 20130429;
+		fixed_seed = true;
+		collision_profile = COLLISION_BLACK_DISK;
+		collision_opacity = 1.;
+		hot_spots = 0;
+		weight_shape = 0.;
+		normalization = 0;
+		deposit_entropy = true;
+		align_order = 0;
+		species = ""; species2 = "";
+		y_beam = 8.; eta_plateau = 1.; eta_width = 1.3;
+		verbose = false;
+	}
+};
+
+class MCGenerator
+{
+protected:
+	MCGConfig config;
+	mc_glauber* glauber_sim;
+	int grid_size;   //cells along x and y
+	sd_real* attached;   //caller's buffer the table sits in, 0: own buffer
+
+public:
+	MCGenerator(const MCGConfig& Config);
+	~MCGenerator();
+
+	bool generate(long int event, EventSummary* summary,
+		sd_real* buffer=0, long int buffer_size=0);   //false: buffer too small
+	const SdTable* getSdTable() {return glauber_sim->getSdTable();}   //last event, no copy
+	void fillSourceList(SourceList* sources);   //sources of the last event
+
+	int getGridSize() {return grid_size;}
+	long int getGridCells() {return (long int)grid_size*grid_size;}
+	double getGridLower() {return config.sd_tbl_min;}
+	double getGridStep() {return config.sd_tbl_step;}
+	const MCGConfig& getConfig() {return config;}
+	mc_glauber* getGlauber() {return glauber_sim;}   //last event, for what is not covered here
+
+private:
+	MCGenerator(const MCGenerator&);   //owns the generator, no copy
+	MCGenerator& operator=(const MCGenerator&);
+};
+
+#endif
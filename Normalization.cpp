@@ -0,0 +1,85 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: read and evaluate the normalisation of the entropy density,
+see Normalization.h
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include "Normalization.h"
+#include "arsenal.h"
+
+using namespace std;
+
+Normalization::Normalization(int Mode)
+{
+	mode = Mode;
+	coef = 1.;
+	power = 0.;
+}
+
+bool Normalization::readTable(string filename)
+{
+	ifstream in(filename.c_str());
+	if(!in.good())
+	{
+		cout << "Normalization: cannot open " << filename << endl;
+		return false;
+	}
+	keys.clear();
+	values.clear();
+	string line;
+	while(getline(in, line))
+	{
+		if(line.empty() || line[0] == '%')
+			continue;
+		istringstream line_stream(line);
+		double key, value;
+		if(!(line_stream >> key >> value))
+			continue;
+		if(!keys.empty() && key <= keys.back())
+		{
+			cout << "Normalization: keys in " << filename << " are not increasing" << endl;
+			keys.clear();
+			values.clear();
+			return false;
+		}
+		keys.push_back(key);
+		values.push_back(value);
+	}
+	return !keys.empty();
+}
+
+void Normalization::setFit(double Coef, double Power)
+{
+	keys.clear();
+	values.clear();
+	coef = Coef;
+	power = Power;
+}
+
+double Normalization::getValue(double key)
+{
+	if(keys.empty())
+		return coef*pow(key, power);
+	if(keys.size() == 1 || key <= keys.front())
+		return values.front();
+	if(key >= keys.back())
+		return values.back();
+	return interpLinearMono(&keys, &values, key);
+}
+
+double Normalization::getScale(double key, double total_entropy)
+{
+	double value = getValue(key);
+	if(mode == NORMALIZE_TARGET)
+		return total_entropy > 0. ? value/total_entropy : 1.;
+	return value;
+}
@@ -0,0 +1,52 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Centrality-dependent normalisation of the entropy density,
+applied by the generator instead of rescaling the written tables offline
+1. The value v(key) of an event comes from a table, "key value" per line
+   (lines starting with % are skipped, keys increasing, linear
+   interpolation, constant beyond the ends), or from the fit
+   v = coef*key^power; the key is Npart;
+2. In SCALE mode v is the factor the entropy density is multiplied by;
+   in TARGET mode v is the wanted \int dxdy sd, e.g. dN/deta times the
+   entropy per particle, and the factor is v/S with S the entropy of the
+   event before normalisation;
+3. mc_glauber::setNormalization() applies the factor to the weights of
+   the sources before anything is deposited, so the table, the summary
+   and the source list all come out normalised without another pass
+   over the grid. S is taken from the sources (disks of area pi*R^2),
+   which agrees with the sum over the table to the accuracy of the grid.
+*/
+
+#ifndef Normalization_h
+#define Normalization_h
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum NormalizationMode { NORMALIZE_SCALE, NORMALIZE_TARGET };
+
+class Normalization
+{
+protected:
+	int mode;
+	vector<double> keys, values;   //table, empty when the fit is used
+	double coef, power;   //fit v = coef*key^power
+
+public:
+	Normalization(int Mode=NORMALIZE_SCALE);
+	~Normalization() {};
+
+	bool readTable(string filename);   //false if the file has no usable table
+	void setFit(double Coef, double Power=0.);
+	double getValue(double key);
+	double getScale(double key, double total_entropy);   //factor for one event
+};
+
+#endif
@@ -0,0 +1,143 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Woods-Saxon parameters and shared sampling tables,
+see NuclearData.h
+
+The radii, diffuseness and deformations are the values commonly used in
+Monte-Carlo Glauber codes (electron scattering fits, deformations from
+the nuclear data tables); Zr96 and Ru96 follow the isobar run. The hard
+core of 0.4 fm is the usual minimum distance between nucleon centres.
+*/
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <iomanip>
+#include "NuclearData.h"
+#include "arsenal.h"
+
+using namespace std;
+
+//species, A, R, a, rho0, beta_2, beta_4, d_min
+static const WoodsSaxonParams ws_table[] = {
+	{"p",     1,   0.,      0.,     0.16,  0.,     0.,     0.},
+	{"O16",   16,  2.608,   0.513,  0.16,  0.,     0.,     0.4},
+	{"Cu63",  63,  4.20641, 0.5977, 0.16,  0.162, -0.006,  0.4},
+	{"Zr96",  96,  5.02,    0.46,   0.16,  0.06,   0.,     0.4},
+	{"Ru96",  96,  5.085,   0.46,   0.16,  0.158,  0.,     0.4},
+	{"Xe129", 129, 5.36,    0.59,   0.16,  0.18,   0.,     0.4},
+	{"Au197", 197, 6.38,    0.535,  0.16, -0.13,  -0.03,   0.4},
+	{"Pb208", 208, 6.62,    0.546,  0.16,  0.,     0.,     0.4},
+	{"U238",  238, 6.81,    0.55,   0.16,  0.28,   0.093,  0.4},
+};
+static const int n_ws_table = sizeof(ws_table)/sizeof(ws_table[0]);
+
+bool findWoodsSaxonParams(string species, WoodsSaxonParams* params)
+{
+	for(int k=0;k<n_ws_table;k++)
+		if(ws_table[k].species == species)
+		{
+			*params = ws_table[k];
+			return true;
+		}
+	return false;
+}
+
+WoodsSaxonParams defaultWoodsSaxonParams(int A)
+{
+	WoodsSaxonParams params;
+	params.species = "";
+	params.A = A;
+	params.radius = 1.25 * pow(double(A), 1./3.);  //unit: fm
+	params.diffuseness = 0.5;   //unit: fm
+	params.rho0 = 0.16;
+	params.beta2 = 0.;
+	params.beta4 = 0.;
+	params.d_min = 0.;
+	return params;
+}
+
+void listWoodsSaxonSpecies(ostream& os)
+{
+	for(int k=0;k<n_ws_table;k++)
+		os << (k ? ", " : "") << ws_table[k].species;
+	os << endl;
+}
+
+
+NucleusSampler::NucleusSampler(const WoodsSaxonParams& Params)
+{
+	params = Params;
+	tbl_min = 0.;
+	tbl_max = 20.;
+	tbl_step = 0.01;
+	max_table = (long int)((tbl_max-tbl_min)/tbl_step+0.1)+1;
+	n_cos = (params.beta2 != 0. || params.beta4 != 0.) ? 100 : 1;
+
+	//one CDF in r per bin of cos(theta), taken at the centre of the bin
+	radial_cdf.resize(n_cos);
+	angular_cdf.assign(n_cos+1, 0.);
+	for(int k=0;k<n_cos;k++)
+	{
+		double cos_theta = -1. + (k+0.5)*2./n_cos;
+		vector<double>& cdf_table = radial_cdf[k];
+		cdf_table.resize(max_table);
+		cdf_table[0] = 0.;
+		for(long int i=1;i<max_table;i++)
+		{
+			double r_step = tbl_min + i * tbl_step;  //current position
+			cdf_table[i] = cdf_table[i-1] + getWoodsSaxonModel(r_step, cos_theta);
+		}
+		angular_cdf[k+1] = angular_cdf[k] + cdf_table.back();  //bins of equal width
+	}
+}
+
+double NucleusSampler::getWoodsSaxonModel(double distance, double cos_theta)
+{
+	double c2 = cos_theta*cos_theta;
+	double y20 = sqrt(5./(16.*M_PI)) * (3.*c2 - 1.);
+	double y40 = 3./(16.*sqrt(M_PI)) * (35.*c2*c2 - 30.*c2 + 3.);
+	double ws_r = params.radius * (1. + params.beta2*y20 + params.beta4*y40);
+	double rho0 = 0.16;   //not params.rho0: the tables are normalised anyway, and this
+						  //is the factor the original CDF was summed with
+	double weight = distance * distance;   //geometry factor for 3D position sampling
+	double result = weight * rho0 /(1 + exp((distance - ws_r)/params.diffuseness));
+	return result;
+}
+
+double NucleusSampler::invertRadial(int bin, double cdf_prob) const
+{
+	vector<double>* cdf_table = const_cast<vector<double>*>(&radial_cdf[bin]);  //read only
+	return tbl_min + tbl_step * binarySearch(cdf_table, cdf_prob, false);
+}
+
+int NucleusSampler::invertAngular(double cdf_prob, double* cos_lower, double* cos_width) const
+{
+	vector<double>* cdf_table = const_cast<vector<double>*>(&angular_cdf);  //read only
+	int bin = binarySearch(cdf_table, cdf_prob, false);
+	*cos_width = 2./n_cos;
+	*cos_lower = -1. + bin * *cos_width;
+	return bin;
+}
+
+const NucleusSampler* NucleusSampler::get(const WoodsSaxonParams& Params)
+{
+	//samplers live until the process ends, nuclei keep plain pointers to them
+	static mutex sampler_lock;
+	static map<string, NucleusSampler*> samplers;
+
+	ostringstream key;   //everything the tables depend on
+	key << setprecision(17) << Params.A << " " << Params.radius << " " << Params.diffuseness
+	    << " " << Params.beta2 << " " << Params.beta4;
+	lock_guard<mutex> guard(sampler_lock);
+	NucleusSampler*& sampler = samplers[key.str()];
+	if(sampler == 0)
+		sampler = new NucleusSampler(Params);
+	return sampler;
+}
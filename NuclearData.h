@@ -0,0 +1,80 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Woods-Saxon parameters of the usual species and the sampling
+tables built from them, shared by all nuclei of the process
+1. findWoodsSaxonParams("Au197", &params) copies the measured radius,
+   diffuseness, deformation beta_2, beta_4 and hard core of a species
+   from the table in NuclearData.cpp; defaultWoodsSaxonParams(A) is the
+   original parametrisation R = 1.25 A^1/3 fm, a = 0.5 fm, spherical,
+   without hard core, still the default of Nucleus;
+2. A deformed nucleus has the radius R(1 + beta_2 Y20(theta) + beta_4
+   Y40(theta)) along the polar angle theta of its symmetry axis;
+3. NucleusSampler::get(params) returns the tables of one shape: the CDF
+   in r of r^2 rho(r) and, if deformed, one such CDF per bin of
+   cos(theta) plus the CDF over the bins; they are built on first use,
+   kept for the life of the process and shared by all threads (read
+   only), so switching species costs a map lookup; rho0 and the hard
+   core do not enter the tables (nor their key), the CDF is always summed
+   with the central density 0.16 fm^-3 of the original tables;
+4. The tables of a spherical shape are those Nucleus used to build for
+   itself, so the configurations drawn from them do not change.
+*/
+
+#ifndef NuclearData_h
+#define NuclearData_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+struct WoodsSaxonParams
+{
+	string species;   //e.g. "Pb208", "" for the default parametrisation
+	int A;   //mass number
+	double radius, diffuseness;   //unit: fm
+	double rho0;   //central density, fm^-3; informational only, the sampling
+					//tables are normalised and always built with 0.16
+	double beta2, beta4;   //deformation, 0 for a spherical nucleus
+	double d_min;   //hard core: least distance between nucleon centres, fm, 0: none
+};
+
+bool findWoodsSaxonParams(string species, WoodsSaxonParams* params);   //false: not in the table
+WoodsSaxonParams defaultWoodsSaxonParams(int A);   //1.25 A^1/3 fm, 0.5 fm
+void listWoodsSaxonSpecies(ostream& os);   //names of the table, one line
+
+class NucleusSampler
+{
+protected:
+	WoodsSaxonParams params;
+	double tbl_min, tbl_max, tbl_step;   //nucleon position r in the CDF tables
+	long int max_table;
+	int n_cos;   //bins of cos(theta) in -1 ~ 1, 1 if spherical
+	vector<vector<double> > radial_cdf;   //CDF in r, one per bin of cos(theta)
+	vector<double> angular_cdf;   //CDF over the bins, n_cos+1 entries
+
+	NucleusSampler(const WoodsSaxonParams& Params);
+	double getWoodsSaxonModel(double distance, double cos_theta);   //r^2 rho
+
+public:
+	static const NucleusSampler* get(const WoodsSaxonParams& Params);  //built on first use
+
+	bool isDeformed() const {return n_cos > 1;}
+	double cdfMax(int bin=0) const {return radial_cdf[bin].back();}
+	double invertRadial(int bin, double cdf_prob) const;  //r at cdf_prob in 0 ~ cdfMax(bin)
+	double angularMax() const {return angular_cdf.back();}
+	int invertAngular(double cdf_prob, double* cos_lower, double* cos_width) const;  //bin
+							//at cdf_prob in 0 ~ angularMax() and its range of cos(theta)
+
+private:
+	NucleusSampler(const NucleusSampler&);
+	NucleusSampler& operator=(const NucleusSampler&);
+};
+
+#endif
@@ -15,36 +15,43 @@ Purpose: Generate and Store information of one nucleus
    sampled nucleons. Use scatter3() in matlab to plot nucleons; 
    hist() in Matlab can plot histogram, use it to see if the distribution
     of generated nucleons satisfies Woods-Saxon distribution.
+5. Every nucleus draws from its own drand48 stream; setSeed() makes the
+   next configuration reproducible, otherwise it is seeded by random_seed().
+   With Verbose=false (setVerbose()) only errors are printed.
+6. The Woods-Saxon parameters are 1.25 A^1/3 fm and 0.5 fm unless a set
+   from NuclearData.h is given; the CDF tables come from the process-wide
+   cache of NucleusSampler, so building another nucleus of the same
+   shape costs a lookup. A deformed nucleus gets a random orientation of
+   its symmetry axis per configuration; with a hard core (d_min > 0) a
+   nucleon closer than d_min to one already placed is drawn again.
 */
 
 #include <cmath>
 #include <iomanip>
 #include "Nucleus.h"
 #include "arsenal.h"
+#include "Instrument.h"
 
 using namespace std;
 
 extern unsigned long int random_seed ();   // routine to generate a seed
  											
-Nucleus::Nucleus(int A_num, double NS, double MS)
+Nucleus::Nucleus(int A_num, double NS, double MS, const WoodsSaxonParams* Params, bool Verbose)
 {
 	A  = A_num;
+	verbose = Verbose;
 	nS = NS;
 	mS = MS;
 
-  //parameters for CDF table
-  tbl_min = 0.;
-  tbl_max = 20.;
-  tbl_step = 0.01;
-  max_table = (long int)((tbl_max-tbl_min)/tbl_step+0.1)+1; //find the length of the CDF lookup table	
-  cdf_max = 0.;  //Initial value, will be assigned a value later
-  cdf_table = 0; //CDF table has not been initialized
+  sampler = 0; //CDF tables have not been looked up
+  cos_tilt = 1.; axis_phi = 0.;
+  has_seed = false; //seed from /dev/urandom unless setSeed() is called
 
   double sigma_nn = 60.;  //nucleon-nucleon cross section unit: mb
   nucleon_radius = sqrt(0.1/(2.*M_PI) * sigma_nn)/2.; //effective radius = sqrt(sigma_nn/2/pi)/2
                                                 //0.1 for convert from sqrt(barn) to fm
                                                 //a factor of 2 since sigma_nn is effective x-section
-  wsInitializion();   //get parameters from Wood-Saxon Model
+  wsInitializion(Params);   //get parameters from Wood-Saxon Model
 }
 
 Nucleus::~Nucleus()
@@ -53,28 +60,35 @@ Nucleus::~Nucleus()
 	{
     	delete nucleons[i];
   	}
-  nucleons.clear();
-  
-  if(cdf_table)  //clean up CDF lookup table
-    delete [] cdf_table;
-
+  nucleons.clear();   //the CDF tables are shared and stay
 }
 
 
-void Nucleus::wsInitializion()  
-//calculate ws_r, ws_d from a given A
+void Nucleus::wsInitializion(const WoodsSaxonParams* params)
+//take the given parameters, or calculate ws_r, ws_d from a given A
 {
-	ws_r = 1.25 * pow(double(A), 1./3.);  //unit: fm
-	ws_a = 0.5;		//unit: fm
-	ws_prob0 = 0.16;  // rho0
-
-	cout<<"Atom number is: "<<A<<endl;  //debug
+	if(params == 0)
+		ws = defaultWoodsSaxonParams(A);
+	else if(params->A != A)
+	{
+		cout << params->species << " has A=" << params->A << ", not " << A << "! Exit..." << endl;
+		exit(-1);
+	}
+	else
+		ws = *params;
+
+	if(verbose)
+		cout<<"Atom number is: "<<A<<endl;  //debug
 }
 
 
 void Nucleus::generateConfiguration()
 {
-  prepareCDFtable();  //generate CDF table and shift it
+  if(sampler == 0 && A > 1)  //the tables only depend on the shape, look them up once
+    prepareCDFtable();
+  for(int i=0;i<(int)nucleons.size();i++)  //a new configuration replaces the old one
+    delete nucleons[i];
+  nucleons.clear();
   //begin invert CDF sampling
   getWSCoordinates(A);
 }
@@ -84,8 +98,8 @@ void Nucleus::getWSCoordinates(int atom_num)
 {
   //invert CDF to get the coordinates
 
-  if(cdf_table == 0 || cdf_max ==0.)  //no cdf table to invert
-                                      //or cdf table is wrongly found
+  if(atom_num > 1 && (sampler == 0 || sampler->cdfMax() == 0.))  //no cdf table to invert
+                                                      //or cdf table is wrongly found
   {
     cout<< "No CDF table, or CDF is wrong! Exit...." << endl;
     exit(-0);
@@ -93,74 +107,122 @@ void Nucleus::getWSCoordinates(int atom_num)
 
   // cout << "Start to get nucleon coordinates:" << endl;
 
-  //prepare CDF table for invert, since it cannot be used by external functions
-  vector<double>* cdf_table_copy=new vector<double>(max_table,0.0);    //copy CDF table
-  for(long int i=0;i<max_table;i++)
-    (*cdf_table_copy)[i]=cdf_table[i];
-
-  srand48(random_seed ());  //random seed
+  if(!has_seed)
+    setSeed(random_seed ());  //random seed
+  has_seed = false;  //a seed is used for one configuration only
+  if(atom_num == 1)  //a single nucleon (proton) sits at the center
+  {
+    nucleons.push_back(new Nucleon(nucleon_radius, 0., 0., 0.));
+    return;
+  }
+  if(sampler->isDeformed())  //orientation of the symmetry axis
+  {
+    MCG_COUNT(CNT_RNG_DRAWS, 2L);
+    cos_tilt = uniform(-1., 1.);
+    axis_phi = uniform(0., 2.*M_PI);
+  }
+  double d_min2 = ws.d_min * ws.d_min;
+  vector<double> z_placed;  //z before the contraction, for the hard core only
   for(int count = 0; count < atom_num; count ++)
   {
-    double t_rand=drand(0., cdf_max);  //get a random number between 0 ~ max value of CDF
-    double cdf_prob = t_rand;  //position probability for CDF table
-    double r_sampled = 0.;  //sampled spherical coordinate r
-
-    int r_idx = binarySearch(cdf_table_copy, cdf_prob, false);  //find the index of CDF element
-    r_sampled = tbl_min + tbl_step* r_idx;   //covert to coordinate r
-
-    //generate theta and phi
-    double cos_theta = drand(-1., 1.);
-    double sin_theta = sqrt(1 - cos_theta * cos_theta);
-    double phi = drand(0., 2.*M_PI);
-    //transform to Cartisan coordinates
-    double x = r_sampled * sin_theta * cos(phi);
-    double y = r_sampled * sin_theta * sin(phi);
-    double z = 0.;   //z=0 due to lorentz contraction
-  
+    double x, y, z;
+    for(int tries = 1; ; tries++)
+    {
+      sampleNucleon(&x, &y, &z);
+      bool too_close = false;
+      for(int k = 0; k < count && d_min2 > 0. && !too_close; k++)
+      {
+        double dx = x - nucleons[k]->getX();
+        double dy = y - nucleons[k]->getY();
+        double dz = z - z_placed[k];
+        too_close = (dx*dx + dy*dy + dz*dz < d_min2);
+      }
+      if(!too_close)
+        break;
+      if(tries == 1000)
+      {
+        cout << "No room for nucleon " << count << " with a hard core of "
+             << ws.d_min << " fm! Exit..." << endl;
+        exit(-1);
+      }
+    }
+    if(d_min2 > 0.)
+      z_placed.push_back(z);
+
     //construct a new nucleon and put the pointer to the vector "nucleons"
     Nucleon* ptr;
-    ptr = new Nucleon(nucleon_radius, x, y, z); 
+    ptr = new Nucleon(nucleon_radius, x, y, 0.);   //z=0 due to lorentz contraction
     nucleons.push_back(ptr);
   }
-  cout << "Nucleus Configuration has been generated!" << endl << endl;
-
-  //clear up before leave
-  delete cdf_table_copy;
+  if(verbose)
+    cout << "Nucleus Configuration has been generated!" << endl << endl;
 }
 
 
-void Nucleus::prepareCDFtable(void)
+void Nucleus::sampleNucleon(double* x, double* y, double* z)
 {
-  // cout << "Start to generate CDF table " << endl;
-
-  //initalize CDF look-up table
-  cdf_table = new double[max_table];
-
-  //generate CDF look-up table
-  cdf_table[0] = 0. ;
-  for (long int i=1;i<max_table; i++)
+  bool deformed = sampler->isDeformed();
+  MCG_COUNT(CNT_RNG_DRAWS, deformed ? 4L : 3L);
+  int bin = 0;  //bin of cos(theta), selects the CDF in r
+  double cos_theta = 0.;
+  if(deformed)  //polar angle from its marginal distribution, uniform within the bin
   {
-    double r_step = tbl_min +  i * tbl_step;  //current position
-    cdf_table[i] = cdf_table[i-1] + getWoodsSaxonModel(r_step);
+    double cos_lower, cos_width;
+    bin = sampler->invertAngular(uniform(0., sampler->angularMax()), &cos_lower, &cos_width);
+    cos_theta = cos_lower + cos_width*uniform(0., 1.);
   }
-  //Assign value for the "normalization"
-  cdf_max = cdf_table[max_table-1];
-  // cout << "CDF table is ready!" << endl << endl;
+  double t_rand=uniform(0., sampler->cdfMax(bin));  //get a random number between 0 ~ max value of CDF
+  double r_sampled = sampler->invertRadial(bin, t_rand);  //sampled spherical coordinate r
+
+  //generate theta and phi
+  if(!deformed)
+    cos_theta = uniform(-1., 1.);
+  double sin_theta = sqrt(1 - cos_theta * cos_theta);
+  double phi = uniform(0., 2.*M_PI);
+  //transform to Cartisan coordinates
+  *x = r_sampled * sin_theta * cos(phi);
+  *y = r_sampled * sin_theta * sin(phi);
+  *z = r_sampled * cos_theta;
+  if(!deformed)
+    return;
+
+  //symmetry axis from z to (cos_tilt, axis_phi): tilt around y, then turn around z
+  double sin_tilt = sqrt(1. - cos_tilt * cos_tilt);
+  double x_tilt = *x * cos_tilt + *z * sin_tilt;
+  double z_tilt = -*x * sin_tilt + *z * cos_tilt;
+  double y_body = *y;
+  *x = x_tilt * cos(axis_phi) - y_body * sin(axis_phi);
+  *y = x_tilt * sin(axis_phi) + y_body * cos(axis_phi);
+  *z = z_tilt;
 }
 
 
-
-double Nucleus::getWoodsSaxonModel(double distance)
+void Nucleus::setSeed(unsigned long int seed)
 {
-// Woods-Saxon model
-	double rho0 = ws_prob0;
-  double weight = distance * distance;   //geometry factor for 3D position sampling
-	double result =  weight * rho0 /(1 + exp((distance - ws_r)/ws_a));
+  //same state as srand48(seed)
+  rng_state[0] = 0x330E;
+  rng_state[1] = (unsigned short)(seed & 0xFFFF);
+  rng_state[2] = (unsigned short)((seed >> 16) & 0xFFFF);
+  has_seed = true;
+}
+
 
-  return result;
+double Nucleus::uniform(double LB, double RB)
+// uniform random number between LB and RB with boundary-protection,
+// like drand() in arsenal.h but thread-safe
+{
+  double width = RB-LB;
+  double dw = width*1e-30;
+  return LB+dw+(width-2*dw)*erand48(rng_state);
 }
 
 
+void Nucleus::prepareCDFtable(void)
+{
+  //built by the first nucleus of this shape in the process, see NuclearData.h
+  sampler = NucleusSampler::get(ws);
+}
+
 
 void Nucleus::shiftNucleus(double x_ctr, double y_ctr)
 {
@@ -178,11 +240,31 @@ void Nucleus::shiftNucleus(double x_ctr, double y_ctr)
 }
 
 
+void Nucleus::rotateNucleus(double angle)
+{
+  double cos_a = cos(angle), sin_a = sin(angle);
+  for(int i=0;i<(int)nucleons.size();i++)
+  {
+    double x = nucleons[i]->getX();
+    double y = nucleons[i]->getY();
+    nucleons[i]->setX(cos_a*x - sin_a*y);
+    nucleons[i]->setY(sin_a*x + cos_a*y);
+  }
+}
+
 
 void Nucleus::dumpNucleonsCoordinates(string filename)
 {
   ofstream of;
   of.open(filename.c_str(), std::ios_base::out);
+  writeNucleonsCoordinates(of);
+  of.close();
+  // cout << "Nucleus has been shifted!" << endl << endl;
+}
+
+
+void Nucleus::writeNucleonsCoordinates(ostream& of)
+{
   for(int i=0;i<(int)nucleons.size();i++)
   {
     double x = nucleons[i]->getX();
@@ -194,6 +276,4 @@ void Nucleus::dumpNucleonsCoordinates(string filename)
        << setw(16) << setprecision(10) << z 
        << endl;
   }
-  of.close();
-  // cout << "Nucleus has been shifted!" << endl << endl;
 }
@@ -9,42 +9,53 @@
 #include "stdlib.h"
 #include "Nucleon.h"
 #include "arsenal.h"
+#include "NuclearData.h"
 
 using namespace std;
 
 
 class Nucleus
 {
+	friend class Benchmark;   //times CDF build and sampling separately
+
 protected:
 	int A;    //atom number
-	double ws_r, ws_a;  //Wood-Saxon model parameters
-	double ws_prob0;
+	WoodsSaxonParams ws;  //Wood-Saxon model parameters, see NuclearData.h
 	double nS;  //nucleon size
 	double mS;  //minimum separation
 	vector<Nucleon*> nucleons;
 	double nucleon_radius;
 
-	//culmulative distribution function look-up table
-	double *cdf_table;  
-	double cdf_max;   //last elements of cdf table which used to do normalization
-	double tbl_min, tbl_max;  //lower and upper limit for nucleon position r in CDF table
-	double tbl_step;   //spacing for position r
-	long int max_table;  //length of the CDF lookup table
+	//culmulative distribution function look-up tables, shared by all nuclei of this shape
+	const NucleusSampler* sampler;  //0 until the first configuration
+	double cos_tilt, axis_phi;  //symmetry axis of a deformed nucleus in this configuration
+
+	unsigned short rng_state[3];  //private drand48 stream of this nucleus
+	bool has_seed;   //false: seed from random_seed() when sampling
+	bool verbose;   //false: print errors only
+	double uniform(double LB, double RB);  //same as drand(), on rng_state
 
-	void wsInitializion(void);  //calculate ws_r, ws_d from a given atom number A
-	void prepareCDFtable(void);  //generate CDF look up table
+	void wsInitializion(const WoodsSaxonParams* params);  //the given parameters, or
+							//ws_r, ws_d from the atom number A
+	void prepareCDFtable(void);  //get the CDF look up tables of this shape
 	void getWSCoordinates(int atom_num); //get nucleon coordinates
 											//by invert CDF
-	double getWoodsSaxonModel(double distance);
+	void sampleNucleon(double* x, double* y, double* z);  //one position, the body frame
+							//rotated by (cos_tilt, axis_phi) if deformed
 
 public:
-	Nucleus(int A_num, double NS=0.4, double MS=0.4);
+	Nucleus(int A_num, double NS=0.4, double MS=0.4, const WoodsSaxonParams* Params=0,
+		bool Verbose=true);  //Params=0: 1.25 A^1/3 fm, see defaultWoodsSaxonParams()
 	~Nucleus();
 
 	void generateConfiguration(void);  //generate nuleus configuration
+	void setVerbose(bool Verbose) {verbose = Verbose;}  //false: print errors only
+	void setSeed(unsigned long int seed);  //reproducible configuration, same stream as srand48(seed)
 	void shiftNucleus(double x_ctr, double y_ctr=0.);//shift the nucleus down in the x-y plane
 													 //to centered in(x_ctr, y_ctr)
+	void rotateNucleus(double angle);  //rotate the nucleus around the origin in the x-y plane
 	double getNucleonSize(void) {return nucleon_radius;}	
+	const WoodsSaxonParams& getWoodsSaxonParams() {return ws;}
 	void getNucleonCoordinates(int idx, double* x, double* y, double* z) {
 		*x= nucleons[idx]->getX();  *y=nucleons[idx]->getY();	*z=nucleons[idx]->getZ();
 	}
@@ -57,6 +68,7 @@ public:
 		return nucleons[idx]->getBCNum();
 	} //get the # of collisions for a nucleon					
 	void dumpNucleonsCoordinates(string filename);  //output the positions of nucleons
+	void writeNucleonsCoordinates(ostream& os);  //same, into any stream
 	 
 };
 
@@ -0,0 +1,169 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: running mean and variance of recentred (and rotated) entropy
+profiles per centrality class, see ProfileAccumulator.h
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include "ProfileAccumulator.h"
+
+using namespace std;
+
+ProfileAccumulator::ProfileAccumulator(const vector<double>& Classes, double Grid_min,
+	double Grid_max, double Grid_step)
+{
+	if(Classes.size() < 2)
+	{
+		cout << "ProfileAccumulator: need at least two class edges! Exit..." << endl;
+		exit(-1);
+	}
+	classes = Classes;
+	n_classes = classes.size() - 1;
+	grid_lower = Grid_min;
+	grid_step = Grid_step;
+	n_grid = (int)((Grid_max-Grid_min)/Grid_step+0.1)+1;
+	count.assign(n_classes, 0.);
+	sum.assign((long int)n_classes*n_grid*n_grid, 0.);
+	sum2.assign((long int)n_classes*n_grid*n_grid, 0.);
+}
+
+int ProfileAccumulator::findClass(double key)
+{
+	if(!(key >= classes[0]) || key > classes[n_classes])
+		return -1;
+	int cls = 0;
+	while(cls < n_classes-1 && key >= classes[cls+1])
+		cls++;
+	return cls;
+}
+
+void ProfileAccumulator::add(double key, SdTable& sd, double x_cm, double y_cm, double psi)
+{
+	int cls = findClass(key);
+	if(cls < 0)
+		return;
+	count[cls] += 1.;
+
+	double cos_psi = cos(psi), sin_psi = sin(psi);
+	double x0 = sd.getX(0), y0 = sd.getY(0);
+	double step = sd.getStep();
+	int nx = sd.getNx(), ny = sd.getNy();
+	double* cls_sum = &sum[(long int)cls*n_grid*n_grid];
+	double* cls_sum2 = &sum2[(long int)cls*n_grid*n_grid];
+
+	for(int i=0;i<n_grid;i++)
+	{
+		double x = grid_lower + i*grid_step;
+		for(int j=0;j<n_grid;j++)
+		{
+			double y = grid_lower + j*grid_step;
+			//position of this output cell in the event table
+			double x_evt = x_cm + cos_psi*x - sin_psi*y;
+			double y_evt = y_cm + sin_psi*x + cos_psi*y;
+			double u = (x_evt - x0)/step;
+			double v = (y_evt - y0)/step;
+			int iu = (int)floor(u), iv = (int)floor(v);
+			if(iu < 0 || iv < 0 || iu >= nx-1 || iv >= ny-1)
+				continue;   //outside of the event table: zero
+			double fu = u - iu, fv = v - iv;
+			double value = (1.-fu)*(1.-fv)*sd.get(iu, iv) + fu*(1.-fv)*sd.get(iu+1, iv)
+			             + (1.-fu)*fv*sd.get(iu, iv+1) + fu*fv*sd.get(iu+1, iv+1);
+			long int k = (long int)i*n_grid + j;
+			cls_sum[k] += value;
+			cls_sum2[k] += value*value;
+		}
+	}
+}
+
+void ProfileAccumulator::merge(const ProfileAccumulator& other)
+{
+	if(other.n_classes != n_classes || other.n_grid != n_grid)
+	{
+		cout << "ProfileAccumulator: cannot merge accumulators of different shape! Exit..." << endl;
+		exit(-1);
+	}
+	for(int cls=0;cls<n_classes;cls++)
+		count[cls] += other.count[cls];
+	for(long int k=0;k<(long int)sum.size();k++)
+	{
+		sum[k] += other.sum[k];
+		sum2[k] += other.sum2[k];
+	}
+}
+
+double ProfileAccumulator::getMean(int cls, int i, int j)
+{
+	if(count[cls] < 1.)
+		return 0.;
+	return sum[((long int)cls*n_grid + i)*n_grid + j]/count[cls];
+}
+
+void ProfileAccumulator::saveState(ostream& os)
+{
+	os.write((const char*)&n_classes, sizeof(n_classes));
+	os.write((const char*)&n_grid, sizeof(n_grid));
+	os.write((const char*)&count[0], count.size()*sizeof(double));
+	os.write((const char*)&sum[0], sum.size()*sizeof(double));
+	os.write((const char*)&sum2[0], sum2.size()*sizeof(double));
+}
+
+bool ProfileAccumulator::loadState(istream& is)
+{
+	int saved_classes, saved_grid;
+	is.read((char*)&saved_classes, sizeof(saved_classes));
+	is.read((char*)&saved_grid, sizeof(saved_grid));
+	if(!is || saved_classes != n_classes || saved_grid != n_grid)
+		return false;
+	is.read((char*)&count[0], count.size()*sizeof(double));
+	is.read((char*)&sum[0], sum.size()*sizeof(double));
+	is.read((char*)&sum2[0], sum2.size()*sizeof(double));
+	return (bool)is;
+}
+
+void ProfileAccumulator::write(string prefix)
+{
+	double grid_upper = grid_lower + (n_grid-1)*grid_step;
+	for(int cls=0;cls<n_classes;cls++)
+	{
+		ostringstream mean_name, std_name;
+		mean_name << prefix << "_class_" << cls << ".dat";
+		std_name << prefix << "_class_" << cls << "_std.dat";
+		ofstream mean_of(mean_name.str().c_str());
+		ofstream std_of(std_name.str().c_str());
+		mean_of << "% x, y from: " << grid_lower << " to " << grid_upper
+		        << ", with step: " << grid_step << endl
+		        << "% mean over " << count[cls] << " events with key in ["
+		        << classes[cls] << ", " << classes[cls+1] << ")" << endl;
+		std_of << "% x, y from: " << grid_lower << " to " << grid_upper
+		       << ", with step: " << grid_step << endl
+		       << "% standard deviation over " << count[cls] << " events with key in ["
+		       << classes[cls] << ", " << classes[cls+1] << ")" << endl;
+
+		double n = count[cls];
+		const double* cls_sum = &sum[(long int)cls*n_grid*n_grid];
+		const double* cls_sum2 = &sum2[(long int)cls*n_grid*n_grid];
+		for(int i=0;i<n_grid;i++)
+		{
+			for(int j=0;j<n_grid;j++)
+			{
+				long int k = (long int)i*n_grid + j;
+				double mean = n > 0. ? cls_sum[k]/n : 0.;
+				double var = n > 1. ? (cls_sum2[k] - n*mean*mean)/(n-1.) : 0.;
+				mean_of << setw(16) << setprecision(8) << mean;
+				std_of << setw(16) << setprecision(8) << sqrt(var > 0. ? var : 0.);
+			}
+			mean_of << endl;
+			std_of << endl;
+		}
+	}
+}
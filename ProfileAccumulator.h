@@ -0,0 +1,57 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Event-averaged entropy density profile per centrality class,
+built while generating, so no event table has to be written to disk
+1. add() takes the entropy table of one event, shifts its center
+   (x_cm, y_cm) to the origin and rotates it by -psi, so that the
+   participant plane psi lies along the x axis (pass psi=0 to skip the
+   rotation); the event is sampled on the output grid with bilinear
+   interpolation and added to the class its key (Npart, b...) falls in;
+2. Each thread keeps its own accumulator, merge() adds them at the end;
+3. write() dumps mean and standard deviation of each class in the same
+   format as mc_glauber::dumpSdTable().
+*/
+
+#ifndef ProfileAccumulator_h
+#define ProfileAccumulator_h
+
+#include <string>
+#include <vector>
+#include "SdTable.h"
+
+using namespace std;
+
+class ProfileAccumulator
+{
+protected:
+	vector<double> classes;   //class edges of the key, size n_classes+1
+	int n_classes;
+	int n_grid;   //output grid is n_grid x n_grid
+	double grid_lower, grid_step;
+	vector<double> count;   //events per class
+	vector<double> sum, sum2;   //per class and cell: sum sd, sum sd^2
+
+public:
+	ProfileAccumulator(const vector<double>& Classes, double Grid_min,
+		double Grid_max, double Grid_step);
+	~ProfileAccumulator() {};
+
+	int findClass(double key);   //-1 if the key is out of range
+	void add(double key, SdTable& sd, double x_cm, double y_cm, double psi=0.);
+	void merge(const ProfileAccumulator& other);
+
+	int getClassCount() { return n_classes; }
+	double getCount(int cls) { return count[cls]; }
+	double getMean(int cls, int i, int j);
+
+	void write(string prefix);   //<prefix>_class_<k>.dat and <prefix>_class_<k>_std.dat
+	void saveState(ostream& os);   //raw sums for a checkpoint
+	bool loadState(istream& is);   //false if the saved shape differs
+};
+
+#endif
@@ -0,0 +1,132 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Loops over the entropy density table, specialised at compile time
+1. A square grid is RuntimeGrid (size, lower edge and step as members) or
+   ProductionGrid (261 x 261 cells, -13 ~ 13 fm in steps of 0.1, all
+   constexpr); both kernels are templates over the grid, which gives the
+   row stride, the loop bounds and the cell coordinates, so on the
+   production grid they are constants folded into the loops;
+   mc_glauber picks ProductionGrid when ProductionGrid::matches() the
+   table, RuntimeGrid for any other square grid and the generic loops
+   otherwise (see depositDisk() and sweepMoments());
+2. fusedMoments<N> sums r^2 and Re, Im (x+iy)^n, r^n of all orders
+   n = 2 ~ N+1 in a single sweep over the window: the powers are complex
+   multiplications and products of r^2 (one sqrt per cell for the odd
+   orders), instead of pow/atan2/cos/sin per cell and order; the table
+   is row-major, so the sweep streams it row by row, once; the results
+   agree with the generic loops of mc_glauber to rounding;
+3. depositKernel adds one source of radius R to the cells it covers; the
+   distance test only takes the square root for cells within a relative
+   1e-9 of the edge, so the table is bit for bit that of the test
+   sqrt(d^2) <= R on every cell.
+*/
+
+#ifndef SdKernels_h
+#define SdKernels_h
+
+#include <cmath>
+#include <algorithm>
+#include "SdTable.h"
+
+using namespace std;
+
+struct RuntimeGrid
+{
+	int size;   //cells along x and y, also the row stride
+	double lower, step;
+	RuntimeGrid(int Size, double Lower, double Step) {size = Size; lower = Lower; step = Step;}
+	double coord(int i) const {return lower + i*step;}
+};
+
+struct ProductionGrid
+{
+	static constexpr int size = 261;
+	static constexpr double lower = -13.;
+	static constexpr double step = 0.1;
+	static double coord(int i) {return lower + i*step;}
+	static bool matches(const SdTable& sd)
+		{return sd.getNx() == size && sd.getNy() == size && sd.getX(0) == lower
+			&& sd.getY(0) == lower && sd.getStep() == step;}
+};
+
+//one sweep over the window around (x_cm, y_cm) for every order at once:
+//r2 = sum sd r^2 dxdy and, for n = 2 ~ N+1, [n-2] of nu_real, nu_img, dn
+//= sum sd Re (x+iy)^n, Im (x+iy)^n, r^n dxdy
+template<int N, class Grid> void fusedMoments(SdTable& sd, const Grid& grid,
+	int i_min, int i_max, int j_min, int j_max, double x_cm, double y_cm,
+	double* r2, double* nu_real, double* nu_img, double* dn)
+{
+	const sd_real* data = sd.getData();
+	double step = grid.step;
+	double area = step*step;
+	double sum_r2 = 0., sum_real[N], sum_img[N], sum_dn[N];
+	for(int n=0;n<N;n++)
+	{
+		sum_real[n] = 0.; sum_img[n] = 0.; sum_dn[n] = 0.;
+	}
+	i_max = min(i_max, grid.size-1);
+	j_max = min(j_max, grid.size-1);
+	for(int i=i_min;i<=i_max;i++)
+	{
+		const sd_real* sd_row = data + (long int)i*grid.size;
+		double x = grid.coord(i) - x_cm;
+		for(int j=j_min;j<=j_max;j++)
+		{
+			double y = grid.coord(j) - y_cm;
+			double rr = x*x + y*y;
+			double weight = sd_row[j]*area;
+			sum_r2 += sd_row[j]*rr*step*step;
+			double re = x, im = y;
+			double r_even = 1., r_odd = sqrt(rr);   //r^(n-2) of either parity
+			for(int n=2;n<N+2;n++)   //unrolled, N is a constant
+			{
+				double re_next = re*x - im*y;   //(x+iy)^n
+				im = re*y + im*x;
+				re = re_next;
+				double& rn = (n%2) ? r_odd : r_even;
+				rn = rr*rn;
+				sum_real[n-2] += re*weight;
+				sum_img[n-2] += im*weight;
+				sum_dn[n-2] += rn*weight;
+			}
+		}
+	}
+	*r2 = sum_r2;
+	for(int n=0;n<N;n++)
+	{
+		nu_real[n] = sum_real[n];
+		nu_img[n] = sum_img[n];
+		dn[n] = sum_dn[n];
+	}
+}
+
+template<class Grid> void depositKernel(SdTable& sd, const Grid& grid, double radius,
+	double s_x, double s_y, double weight, int i_min, int i_max, int j_min, int j_max)
+{
+	sd_real* data = sd.getData();
+	double r2_in = radius*radius*(1. - 1e-9);   //surely inside below, surely outside above
+	double r2_out = radius*radius*(1. + 1e-9);
+	int i_a = max(i_min, (int)floor((s_x - radius - grid.lower)/grid.step));
+	int i_b = min(min(i_max, grid.size-1), (int)ceil((s_x + radius - grid.lower)/grid.step));
+	int j_a = max(j_min, (int)floor((s_y - radius - grid.lower)/grid.step));
+	int j_b = min(min(j_max, grid.size-1), (int)ceil((s_y + radius - grid.lower)/grid.step));
+	for(int i=i_a;i<=i_b;i++)
+	{
+		sd_real* sd_row = data + (long int)i*grid.size;
+		double dx = grid.coord(i) - s_x;
+		for(int j=j_a;j<=j_b;j++)
+		{
+			double dy = grid.coord(j) - s_y;
+			double d2 = dx*dx + dy*dy;
+			if(d2 <= r2_in || (d2 <= r2_out && sqrt(d2) <= radius))
+				sd_row[j] += weight;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,186 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: allocation and reuse of the contiguous entropy density table,
+see SdTable.h
+
+Sparse format (lines starting with % are comments):
+  nx ny x_lower y_lower step
+  i j_start n v_1 ... v_n      one line per run of nonzero cells in row i
+Cells not listed are zero.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include "SdTable.h"
+
+using namespace std;
+
+SdTable::SdTable()
+{
+	nx = 0; ny = 0;
+	capacity = 0;
+	data = 0;
+	owns_data = true;
+	x_lower = 0.; y_lower = 0.; step = 0.;
+}
+
+SdTable::SdTable(int Nx, int Ny, double X_lower, double Y_lower, double Step)
+{
+	nx = 0; ny = 0;
+	capacity = 0;
+	data = 0;
+	owns_data = true;
+	resize(Nx, Ny, X_lower, Y_lower, Step);
+}
+
+SdTable::~SdTable()
+{
+	if(data && owns_data)
+		free(data);
+}
+
+void SdTable::attach(sd_real* Buffer, long int Capacity)
+{
+	if(data && owns_data)
+		free(data);
+	data = Buffer;
+	capacity = Buffer ? Capacity : 0;
+	owns_data = (Buffer == 0);
+	if(size() > capacity)   //keep the table within the new buffer
+	{
+		nx = 0; ny = 0;
+	}
+}
+
+void SdTable::resize(int Nx, int Ny, double X_lower, double Y_lower, double Step)
+{
+	nx = Nx; ny = Ny;
+	x_lower = X_lower; y_lower = Y_lower;
+	step = Step;
+
+	long int n_cells = (long int)nx*ny;
+	if(n_cells > capacity)   //only grow the buffer, never shrink it
+	{
+		if(!owns_data)
+		{
+			cout << "Entropy density table of " << nx << "x" << ny
+			     << " cells does not fit into the attached buffer of "
+			     << capacity << " cells! Exit..." << endl;
+			exit(-1);
+		}
+		if(data)
+			free(data);
+		void* ptr = 0;
+		if(posix_memalign(&ptr, 64, n_cells*sizeof(sd_real)) != 0)
+		{
+			cout << "Cannot allocate entropy density table of "
+			     << nx << "x" << ny << " cells! Exit..." << endl;
+			exit(-1);
+		}
+		data = (sd_real*)ptr;
+		capacity = n_cells;
+	}
+	clear();
+}
+
+void SdTable::clear()
+{
+	if(data)
+		memset(data, 0, size()*sizeof(sd_real));
+}
+
+void SdTable::downsample(const SdTable& fine, int factor)
+{
+	int h = factor/2;   //coarse cell I covers the fine cells factor*I-h ~ factor*I-h+factor-1
+	int Nx = (fine.nx-1+h)/factor + 1;
+	int Ny = (fine.ny-1+h)/factor + 1;
+	double shift = (factor-1)/2. - h;   //center of the cells I=0 in fine steps
+	resize(Nx, Ny, fine.x_lower + shift*fine.step, fine.y_lower + shift*fine.step,
+		factor*fine.step);
+	double norm = 1./((double)factor*factor);
+	for(int i=0;i<fine.nx;i++)
+	{
+		const sd_real* fine_row = fine.data + (long int)i*fine.ny;
+		sd_real* coarse_row = data + (long int)((i+h)/factor)*ny;
+		for(int j=0;j<fine.ny;j++)
+			coarse_row[(j+h)/factor] += fine_row[j]*norm;
+	}
+}
+
+void SdTable::writeSparse(ostream& os) const
+{
+	os << nx << " " << ny << " " << setprecision(10) << x_lower << " "
+	   << y_lower << " " << step << endl;
+	for(int i=0;i<nx;i++)
+	{
+		const sd_real* sd_row = data + (long int)i*ny;
+		int j=0;
+		while(j<ny)
+		{
+			if(sd_row[j] == 0.)
+			{
+				j++;
+				continue;
+			}
+			int j_start = j;   //find the end of this run of nonzero cells
+			while(j<ny && sd_row[j] != 0.)
+				j++;
+			os << i << " " << j_start << " " << j-j_start;
+			for(int k=j_start;k<j;k++)
+				os << " " << setprecision(8) << sd_row[k];
+			os << endl;
+		}
+	}
+}
+
+//largest table readSparse() accepts, 2^28 cells (2 GB of doubles)
+static const long int max_sparse_cells = 1L << 28;
+
+bool SdTable::readSparse(istream& is)
+{
+	string line;
+	bool has_size = false;
+	while(getline(is, line))
+	{
+		if(line.empty() || line[0] == '%')  //skip comments
+			continue;
+		istringstream sst(line);
+		if(!has_size)
+		{
+			int Nx, Ny;
+			double X_lower, Y_lower, Step;
+			if(!(sst >> Nx >> Ny >> X_lower >> Y_lower >> Step))
+				return false;
+			if(Nx <= 0 || Ny <= 0 || !(Step > 0.)
+			   || (long int)Nx*Ny > max_sparse_cells
+			   || (!owns_data && (long int)Nx*Ny > capacity))   //a broken header, not a table
+				return false;
+			resize(Nx, Ny, X_lower, Y_lower, Step);
+			has_size = true;
+			continue;
+		}
+		int i, j_start, n;
+		if(!(sst >> i >> j_start >> n))
+			return false;
+		if(i<0 || i>=nx || j_start<0 || n<0 || (long int)j_start+n>ny)
+			return false;
+		sd_real* sd_row = row(i);
+		for(int k=0;k<n;k++)
+		{
+			double value;
+			if(!(sst >> value))
+				return false;
+			sd_row[j_start+k] = value;
+		}
+	}
+	return has_size;
+}
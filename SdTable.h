@@ -0,0 +1,82 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Store the entropy density table in the transverse plane
+1. One contiguous, 64-byte aligned buffer, row-major: cell (i,j) sits at
+   data[i*ny+j], with i along x and j along y (same order as the output file);
+2. The buffer is kept when the table is resized to the same or a smaller
+   size, so one table can be reused from event to event;
+3. Compile with -DSD_TABLE_FLOAT to store cells as float instead of double,
+   which halves the memory traffic for large tables;
+4. writeSparse() stores only the runs of nonzero cells of each row, 
+   readSparse() rebuilds the dense table from such a file, refusing
+   headers with no cells, a step <= 0 or more than 2^28 cells;
+5. attach() makes the table use a buffer owned by the caller (e.g. the
+   array of a hydro code), which then receives the cells directly; such
+   a table never reallocates, resize() beyond its capacity is an error;
+6. downsample() turns a table into one with a factor times larger cells,
+   each the mean of the factor x factor cells it covers, so \int dxdy sd
+   is kept exactly; with an odd factor the coarse cells are centred on
+   every factor-th fine cell (e.g. -13 ~ 13 in steps of 0.5 from 0.1),
+   cells beyond the fine table count as zero.
+*/
+
+#ifndef SdTable_h
+#define SdTable_h
+
+#include <iostream>
+
+using namespace std;
+
+#ifdef SD_TABLE_FLOAT
+typedef float sd_real;
+#else
+typedef double sd_real;
+#endif
+
+class SdTable
+{
+protected:
+	int nx, ny;   //number of cells in x and y direction
+	long int capacity;   //number of cells the buffer can hold
+	sd_real* data;   //row-major cells, aligned to a cache line
+	bool owns_data;   //false: buffer from attach(), not freed here
+	double x_lower, y_lower, step;   //position of cell (0,0) and spacing
+
+public:
+	SdTable();
+	SdTable(int Nx, int Ny, double X_lower, double Y_lower, double Step);
+	~SdTable();
+
+	void resize(int Nx, int Ny, double X_lower, double Y_lower, double Step);
+	void clear(void);   //set all cells to zero
+	void attach(sd_real* Buffer, long int Capacity);   //use the caller's buffer of
+							//Capacity cells from now on, Buffer=0 goes back to an own one
+
+	void downsample(const SdTable& fine, int factor);   //become the coarse version of fine
+
+	void writeSparse(ostream& os) const;  //dump nonzero runs row by row
+	bool readSparse(istream& is);   //rebuild the dense table, false if the input is broken
+
+	sd_real& operator()(int i, int j) { return data[(long int)i*ny + j]; }
+	sd_real get(int i, int j) const { return data[(long int)i*ny + j]; }
+	sd_real* row(int i) { return data + (long int)i*ny; }
+	sd_real* getData() { return data; }   //hand the whole buffer out without copy
+
+	int getNx() const { return nx; }
+	int getNy() const { return ny; }
+	long int size() const { return (long int)nx*ny; }
+	double getStep() const { return step; }
+	double getX(int i) const { return x_lower + i*step; }
+	double getY(int j) const { return y_lower + j*step; }
+
+private:
+	SdTable(const SdTable&);   //tables own their buffer, no copy
+	SdTable& operator=(const SdTable&);
+};
+
+#endif
@@ -0,0 +1,128 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: pack and read the per-event source lists,
+see SourceList.h for the file layout
+*/
+
+#include <fstream>
+#include <cstring>
+#include <stdint.h>
+#include "SourceList.h"
+
+using namespace std;
+
+static const char source_magic[8] = {'M','C','G','S','R','C','2','\0'};
+
+template<class T> static void packValue(string& buffer, T value)
+{
+	buffer.append((const char*)&value, sizeof(T));
+}
+
+template<class T> static bool readValue(istream& is, T* value)
+{
+	return (bool)is.read((char*)value, sizeof(T));
+}
+
+string sourceListHeader(double alpha, double width)
+{
+	string buffer(source_magic, 8);
+	packValue<float>(buffer, (float)alpha);
+	packValue<float>(buffer, (float)width);
+	return buffer;
+}
+
+string packSourceList(const SourceList& sources)
+{
+	int32_t n_wounded = sources.wounded.size();
+	int32_t n_binary = sources.binary.size();
+	string buffer;
+	buffer.reserve(24 + 20*n_wounded + 12*n_binary);
+	packValue<int64_t>(buffer, sources.event_id);
+	packValue<double>(buffer, sources.b);
+	packValue<int32_t>(buffer, n_wounded);
+	packValue<int32_t>(buffer, n_binary);
+	for(int k=0;k<n_wounded;k++)
+	{
+		const WoundedSource& source = sources.wounded[k];
+		packValue<float>(buffer, source.x);
+		packValue<float>(buffer, source.y);
+		packValue<float>(buffer, source.weight);
+		packValue<int16_t>(buffer, source.nucleus);
+		packValue<int16_t>(buffer, source.n_coll);
+		packValue<int32_t>(buffer, source.index);
+	}
+	for(int k=0;k<n_binary;k++)
+	{
+		packValue<float>(buffer, sources.binary[k].x);
+		packValue<float>(buffer, sources.binary[k].y);
+		packValue<float>(buffer, sources.binary[k].weight);
+	}
+	return buffer;
+}
+
+bool readSourceLists(string filename, vector<SourceList>* records, double* alpha, double* width)
+{
+	ifstream is(filename.c_str(), ios::in | ios::binary);
+	char magic[8];
+	float header_alpha, header_width;
+	if(!is.read(magic, 8) || memcmp(magic, source_magic, 8) != 0
+	   || !readValue(is, &header_alpha) || !readValue(is, &header_width))
+	{
+		cout << "readSourceLists: " << filename << " is not a source file" << endl;
+		return false;
+	}
+	if(alpha)
+		*alpha = header_alpha;
+	if(width)
+		*width = header_width;
+
+	int64_t event_id;
+	while(readValue(is, &event_id))
+	{
+		SourceList sources;
+		int32_t n_wounded, n_binary;
+		sources.event_id = event_id;
+		readValue(is, &sources.b);
+		readValue(is, &n_wounded);
+		if(!readValue(is, &n_binary) || n_wounded < 0 || n_binary < 0)
+		{
+			cout << "readSourceLists: " << filename << " ends in a broken record" << endl;
+			return false;
+		}
+		sources.wounded.resize(n_wounded);
+		for(int k=0;k<n_wounded;k++)
+		{
+			WoundedSource& source = sources.wounded[k];
+			int16_t nucleus, n_coll;
+			int32_t index;
+			readValue(is, &source.x);
+			readValue(is, &source.y);
+			readValue(is, &source.weight);
+			readValue(is, &nucleus);
+			readValue(is, &n_coll);
+			readValue(is, &index);
+			source.nucleus = nucleus;
+			source.n_coll = n_coll;
+			source.index = index;
+		}
+		sources.binary.resize(n_binary);
+		for(int k=0;k<n_binary;k++)
+		{
+			readValue(is, &sources.binary[k].x);
+			readValue(is, &sources.binary[k].y);
+			readValue(is, &sources.binary[k].weight);
+		}
+		if(!is)
+		{
+			cout << "readSourceLists: " << filename << " ends in a broken record" << endl;
+			return false;
+		}
+		records->push_back(sources);
+	}
+	return true;
+}
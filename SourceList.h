@@ -0,0 +1,65 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Owned by Code: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Per-event list of the entropy sources, for models and hydro
+codes that do their own smearing instead of reading the grid
+1. mc_glauber::fillSourceList() fills everything except event_id; it
+   only needs overlap(), the entropy table may be skipped altogether
+   (mc_glauber::setDepositEntropy(false));
+2. File layout (little endian, as written by the host):
+   header: 8 bytes "MCGSRC2\0", float32 alpha (weight of a wounded
+           nucleon, 1-alpha for a binary collision), float32 radius of
+           the hard disk the entropy is spread over
+   records: int64 event_id, float64 b, int32 n_wounded, int32 n_binary,
+            n_wounded x {float32 x, y, weight, int16 nucleus (1 or 2),
+                         int16 binary collisions of this nucleon,
+                         int32 index of the nucleon in its nucleus}
+            n_binary x {float32 x, y, weight}
+3. weight is the entropy of the source: alpha or 1-alpha, times its
+   gamma factor when weight fluctuations are on;
+4. Records have a variable size; a Pb+Pb event at b=6fm takes ~9 kB against
+   ~1 MB for the text table.
+*/
+
+#ifndef SourceList_h
+#define SourceList_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+struct WoundedSource
+{
+	float x, y;
+	float weight;
+	short int nucleus;   //1 or 2
+	short int n_coll;    //binary collisions of this nucleon
+	int index;           //nucleon number in its nucleus
+};
+
+struct BinarySource
+{
+	float x, y;
+	float weight;
+};
+
+struct SourceList
+{
+	long int event_id;
+	double b;   //impact parameter
+	vector<WoundedSource> wounded;
+	vector<BinarySource> binary;
+};
+
+string sourceListHeader(double alpha, double width);   //bytes that open a source file
+string packSourceList(const SourceList& sources);   //one binary record
+bool readSourceLists(string filename, vector<SourceList>* records,
+	double* alpha=0, double* width=0);  //false if the file is not a source file
+
+#endif
@@ -1,4 +1,4 @@
-// Version 1.7.0
+// Version 1.8.0
 // Zhi Qiu
 
 #ifndef arsenal_h
@@ -34,6 +34,9 @@ string trim(string str);
 vector< vector<double>* >* readBlockData(istream &stream_in);
 void releaseBlockData(vector< vector<double>* >* data);
 
+double parseDouble(const char* &ptr, const char* end);
+bool readBlockDataFast(string filename, vector<double>& data, long& n_rows, long& n_cols, int n_threads=1); // data is column-major: data[col*n_rows+row]
+
 double adaptiveSimpsonsAux(double (*f)(double), double a, double b, double epsilon, double S, double fa, double fb, double fc, int bottom);
 double adaptiveSimpsons(double (*f)(double), double a, double b,  double epsilon=1e-15, int maxRecursionDepth=50);
 
@@ -120,4 +123,11 @@ void get_bin_average_and_count(istream& is, ostream& os, vector<double>* bins, l
  -- Ver 1.7.0:
     Functions added: is_integer, binomial_coefficient, beta_function, 
     log_gamma_function.
+ -- Ver 1.8.0:
+    Functions added: parseDouble, readBlockDataFast. readBlockDataFast maps
+    the file into memory, parses it in parallel chunks without a line
+    length limit, skips comment lines starting with % or #, and returns
+    all columns in one contiguous buffer.
+    Function get_bin_average_and_count keeps its sums on the heap; see also
+    BinAccumulator for multithreaded binning with higher moments.
 -----------------------------------------------------------------------*/
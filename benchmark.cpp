@@ -0,0 +1,221 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Code Name: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Time every stage of the event pipeline separately
+
+Build and run:
+> make -f make_mc_glauber bench
+> bench [events per configuration]
+
+Stages: cdf (CDF tables of both nuclei, from the process-wide cache
+after the first event of a shape, see NuclearData.h), sampling (nucleon positions and
+shift), overlap (collision search, black disk unless the system name
+says gauss, nucleons without substructure unless it says spots,
+U+U with the measured deformed Woods-Saxon shape), deposit (active window and
+distEntropy), moments (findSdCM and eccentricities at order 2 and 3),
+dump (dumpSdTable formatting into /dev/null). deposit_generic and
+moments_generic repeat deposit and moments with setGenericKernels(true),
+the loops without the compiled kernels of SdKernels.h, deposit_runtime
+and moments_runtime with setRuntimeGrid(true), the kernels without the
+constants of the production grid (the same as deposit and moments at
+other steps), for comparison.
+
+Output, one CSV line per configuration and stage on stdout:
+system,A1,A2,b,step,stage,events,total_s,ns_per_event,events_per_s,allocs_per_event
+events_per_s is for the stage alone, the "event" line sums all stages
+but the four comparisons.
+Allocations count calls of operator new; posix_memalign used by SdTable
+is not included. The generator's own printout is suppressed.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+#include <chrono>
+#include <atomic>
+#include "mc_glauber.h"
+
+using namespace std;
+
+static atomic<long> allocation_count(0);
+
+void* operator new(size_t size)
+{
+	allocation_count++;
+	void* ptr = malloc(size ? size : 1);
+	if(ptr == 0)
+		throw bad_alloc();
+	return ptr;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+
+#define N_STAGES 10
+#define N_PIPELINE 6   //stages of an event, the others are comparisons
+static const char* stage_names[N_STAGES] = {"cdf", "sampling", "overlap",
+	"deposit", "moments", "dump", "deposit_generic", "moments_generic",
+	"deposit_runtime", "moments_runtime"};
+
+class Benchmark
+{
+protected:
+	double seconds[N_STAGES];
+	long allocations[N_STAGES];
+	int events;
+	chrono::steady_clock::time_point start;
+	long start_allocations;
+
+	void begin() { start_allocations = allocation_count; start = chrono::steady_clock::now(); }
+	void end(int stage)
+	{
+		seconds[stage] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		allocations[stage] += allocation_count - start_allocations;
+	}
+
+public:
+	Benchmark()
+	{
+		for(int k=0;k<N_STAGES;k++)
+		{
+			seconds[k] = 0.;
+			allocations[k] = 0;
+		}
+		events = 0;
+	}
+
+	void runEvent(int A1, int A2, double b, double step, int profile, int n_spots,
+		string species, ostream& sink)
+	{
+		mc_glauber* glauber_sim = new mc_glauber(A1, b, -13., 13., step, A2);
+		glauber_sim->setSpecies(species, species);
+		glauber_sim->setCollisionProfile(profile);
+		glauber_sim->setHotSpots(n_spots);
+
+		begin();
+		glauber_sim->Nuc1->prepareCDFtable();
+		glauber_sim->Nuc2->prepareCDFtable();
+		end(0);
+
+		begin();
+		glauber_sim->generateNuclei();   //CDF tables are already there
+		end(1);
+
+		begin();
+		glauber_sim->findCollisions();
+		end(2);
+
+		begin();
+		glauber_sim->findActiveWindow();
+		glauber_sim->distEntropy();
+		end(3);
+
+		begin();
+		double x_cm, y_cm;
+		glauber_sim->findSdCM(&x_cm, &y_cm);
+		glauber_sim->getEccentricity(2);
+		glauber_sim->getEccentricity(3);
+		end(4);
+
+		begin();
+		glauber_sim->writeSdTable(sink);
+		end(5);
+
+		glauber_sim->setGenericKernels(true);
+		begin();
+		glauber_sim->distEntropy();   //same table again
+		end(6);
+
+		begin();
+		glauber_sim->findSdCM(&x_cm, &y_cm);
+		glauber_sim->getEccentricity(2);
+		glauber_sim->getEccentricity(3);
+		end(7);
+
+		glauber_sim->setGenericKernels(false);
+		glauber_sim->setRuntimeGrid(true);
+		begin();
+		glauber_sim->distEntropy();
+		end(8);
+
+		begin();
+		glauber_sim->findSdCM(&x_cm, &y_cm);
+		glauber_sim->getEccentricity(2);
+		glauber_sim->getEccentricity(3);
+		end(9);
+
+		delete glauber_sim;
+		events++;
+	}
+
+	void report(ostream& os, string system, int A1, int A2, double b, double step)
+	{
+		double total_s = 0.;
+		long total_allocations = 0;
+		for(int k=0;k<=N_STAGES;k++)
+		{
+			double s = (k < N_STAGES) ? seconds[k] : total_s;
+			long a = (k < N_STAGES) ? allocations[k] : total_allocations;
+			os << system << "," << A1 << "," << A2 << "," << b << "," << step << ","
+			   << (k < N_STAGES ? stage_names[k] : "event") << "," << events << ","
+			   << setprecision(6) << s << ","
+			   << setprecision(6) << s/events*1e9 << ","
+			   << setprecision(6) << events/(s + 1e-30) << ","
+			   << setprecision(6) << (double)a/events << endl;
+			if(k < N_PIPELINE)
+			{
+				total_s += s;
+				total_allocations += a;
+			}
+		}
+	}
+};
+
+
+int main(int argc, char* argv[])
+{
+	int nevents = 20;  //events per configuration
+	if(argc > 1)
+		nevents = atoi(argv[1]);
+
+	//representative systems: name, A1, A2, impact parameter
+	const int n_systems = 9;
+	string systems[n_systems] = {"p+Pb", "p+Pb", "Pb+Pb", "Pb+Pb", "Pb+Pb", "Pb+Pb gauss",
+		"p+Pb spots", "Pb+Pb spots", "U+U"};
+	int A1[n_systems] = {208, 208, 208, 208, 208, 208, 208, 208, 238};
+	int A2[n_systems] = {1, 1, 208, 208, 208, 208, 1, 208, 238};
+	double b[n_systems] = {0., 3., 0., 6., 12., 6., 0., 6., 0.};
+	int profile[n_systems] = {COLLISION_BLACK_DISK, COLLISION_BLACK_DISK, COLLISION_BLACK_DISK,
+		COLLISION_BLACK_DISK, COLLISION_BLACK_DISK, COLLISION_GAUSSIAN,
+		COLLISION_BLACK_DISK, COLLISION_BLACK_DISK, COLLISION_BLACK_DISK};
+	int n_spots[n_systems] = {0, 0, 0, 0, 0, 0, 3, 3, 0};
+	string species[n_systems] = {"", "", "", "", "", "", "", "", "U238"};  //"": 1.25 A^1/3 fm
+	const int n_steps = 2;
+	double steps[n_steps] = {0.1, 0.2};
+
+	cout << "system,A1,A2,b,step,stage,events,total_s,ns_per_event,events_per_s,allocs_per_event" << endl;
+
+	ofstream sink("/dev/null");
+	streambuf* cout_buffer = cout.rdbuf();
+	for(int s=0;s<n_systems;s++)
+		for(int k=0;k<n_steps;k++)
+		{
+			Benchmark bench;
+			cout.rdbuf(sink.rdbuf());   //silence the generator
+			for(int i=0;i<nevents;i++)
+				bench.runEvent(A1[s], A2[s], b[s], steps[k], profile[s], n_spots[s], species[s], sink);
+			cout.rdbuf(cout_buffer);
+			bench.report(cout, systems[s], A1[s], A2[s], b[s], steps[k]);
+		}
+
+	return 0;
+}
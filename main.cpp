@@ -29,6 +29,8 @@ Result check:
 Need to do:
 After generating the entropy density, the profile should be scaled 
 according to final multiplicity before putting it to hydrodynamics simulation.
+Set norm_table or norm_fit_coef below to do it in the generator, see
+Normalization.h.
 
 Revise history:
 Apr.29, 2013 add a loop in the main program, which enables
@@ -47,15 +49,53 @@ Mar.23, 2013 Creat header file and source file;
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <cstdio>
+#include <cstdlib>
 #include "mc_glauber.h"
+#include "EventQueue.h"
+#include "FrameWriter.h"
+#include "BinAccumulator.h"
+#include "ProfileAccumulator.h"
+#include "Checkpoint.h"
+#include "Normalization.h"
 #include "time.h"
 using namespace std;
 
-int main()
+//outputs formatted by the generator threads, EventSlot::text
+enum SlotText { SLOT_SD, SLOT_NUCLEONS, SLOT_SOURCE_HEADER, SLOT_SOURCES, SLOT_ECC,
+	N_SLOT_TEXTS };
+
+//file name of an output shared by all events: unchanged for a single
+//process, with the suffix .shard_<k>_of_<N> for shard k of N processes,
+//merge_shards puts the pieces back together
+string outputName(string name, int shard, int n_shards)
+{
+	if(n_shards <= 1)
+		return name;
+	ostringstream name_stream;
+	name_stream << name << ".shard_" << shard << "_of_" << n_shards;
+	return name_stream.str();
+}
+
+//record where a writer stands, after all its frames are on disk
+void checkpointWriter(Checkpoint& checkpoint, FrameWriter* writer)
+{
+	if(writer == 0)
+		return;
+	long int idx_size;
+	checkpoint.addFile(writer->getFilename(), writer->sync(&idx_size));
+	if(writer->isCompressed())
+		checkpoint.addFile(writer->getFilename() + ".idx", idx_size);
+}
+
+int main(int argc, char* argv[])
 {
 	//parameters for generating nuclei configurations
 	int atom_num = 208;  //atomic number of colliding nucleus
 	double impact_parameter = 6.;  //specify impact parameter
+	string species = "";  //"": Woods-Saxon radius 1.25*A^(1/3) fm and 0.5 fm for both nuclei,
+						  //else measured parameters of a species with atom_num nucleons,
+						  //e.g. "Pb208", "Au197", "U238" (deformed), see NuclearData.h
 
     //parameters for entropy density table
 	double sd_tbl_min = -13.;  
@@ -67,6 +107,162 @@ int main()
 	//parameters for the main program
 	int nevents = 10;   //specify the total events of colllision
 	int ecc_order = 2;  //specify the order of eccentricity
+	bool sparse_output = false;  //true: only dump nonzero cells of the entropy table,
+								 //read back with SdTable::readSparse()
+	bool compress_output = false;  //true: gzip all outputs, one frame per event in
+								   //a single file per output, see FrameWriter.h
+	bool dump_nucleons = false;  //true: also dump the nucleon positions of each event
+	bool dump_3d = false;  //true: also dump the table extended in eta_s, one binary
+						   //file per event written slab by slab, see mc_glauber.cpp
+	double eta_max = 5.;  //eta_s from -eta_max to eta_max
+	double eta_step = 0.1;
+	double y_beam = 8.;  //wounded nucleons fall off linearly towards y_beam
+	int ecc_frame_events = 1000;  //eccentricity lines per compressed frame
+	bool bin_by_npart = false;  //true: stream eccentricities into Npart bins,
+								//see BinAccumulator.h
+	double npart_bin_width = 20.;  //bins from 0 to 2*atom_num
+	bool dump_tables = true;  //false: no entropy table of single events is written
+	vector<double> extra_steps = {};  //the tables again at these steps, e.g. {0.5, 0.05}:
+									  //block averages for odd multiples of sd_tbl_step,
+									  //else deposited anew, see mc_glauber::resample()
+	bool dump_sources = false;  //true: binary list of wounded nucleons and binary
+								//collisions of each event, see SourceList.h
+	int collision_profile = COLLISION_BLACK_DISK;  //nucleon-nucleon P(b), see mc_glauber.h
+	double collision_opacity = 1.;  //p0 of the gray disk and Gaussian profiles
+	double weight_shape = 0.;  //gamma shape k of the entropy of each source, 0: fixed
+	string norm_table = "";  //"Npart value" table of the normalisation, see Normalization.h
+	double norm_fit_coef = 0.;  //without a table: value = coef*Npart^power, 0: no normalisation
+	double norm_fit_power = 1.;
+	bool norm_to_target = true;  //true: value is the wanted total entropy,
+								 //false: value is the factor itself
+	int hot_spots = 0;  //constituents per nucleon, 0: nucleons without substructure
+	bool deposit_entropy = true;  //false: never build the entropy table, eccentricities
+								  //come from the sources; no tables, no averaged profiles
+	int align_order = 0;  //>0: every event is recentred and rotated by its Psi_n of this
+						  //order before deposition, all outputs describe the aligned event
+	bool average_profiles = false;  //true: average the recentred profiles in Npart
+									//classes, see ProfileAccumulator.h
+	bool rotate_profiles = true;  //rotate each profile by its participant plane Psi_2
+	double profile_class_width = 100.;  //Npart classes from 0 to 2*atom_num
+	int instrument_every = 100;  //events between two reports of the counters and timers,
+								 //only with -DMCG_INSTRUMENT, see Instrument.h
+	int checkpoint_every = 100;  //events between two checkpoints, 0: none, see Checkpoint.h;
+								 //with compress_output rounded up to a multiple of ecc_frame_events
+	int generator_threads = 2;  //threads generating events while this one writes them,
+								//the outputs do not depend on it, see EventQueue.h
+	int event_slots = 0;  //events ready or in the making at most, 0: 4 per generator thread
+
+	//parameters for running many processes, set from the command line:
+	//main [--nevents n] [--seed s] [--shard k/N] [--resume]
+	//shard k of N generates the events k*n/N+1 ~ (k+1)*n/N, with a
+	//seed derived from s and the event number, so the union of all
+	//shards does not depend on N
+	int shard = 0, n_shards = 1;
+	bool fixed_seed = false;   //false: every event is seeded from /dev/urandom
+	unsigned long int run_seed = 20130429;   //default seed for sharded runs
+	bool resume = false;   //continue from the last checkpoint
+
+	for(int k=1;k<argc;k++)
+	{
+		string arg = argv[k];
+		if(arg == "--nevents" && k+1 < argc)
+			nevents = atoi(argv[++k]);
+		else if(arg == "--seed" && k+1 < argc)
+		{
+			run_seed = strtoul(argv[++k], 0, 10);
+			fixed_seed = true;
+		}
+		else if(arg == "--shard" && k+1 < argc
+				&& sscanf(argv[k+1], "%d/%d", &shard, &n_shards) == 2)
+			k++;
+		else if(arg == "--resume")
+			resume = true;
+		else
+		{
+			cout << "Usage: " << argv[0]
+			     << " [--nevents n] [--seed s] [--shard k/N] [--resume]" << endl;
+			return 1;
+		}
+	}
+	if(n_shards < 1 || shard < 0 || shard >= n_shards)
+	{
+		cout << "Shard " << shard << "/" << n_shards << " does not exist! Exit..." << endl;
+		return 1;
+	}
+	if(dump_3d && (!(eta_step > 0.) || !(eta_max >= 0.)))
+	{
+		cout << "Bad eta_s range: eta_max=" << eta_max << ", eta_step=" << eta_step
+		     << ", need eta_max >= 0 and eta_step > 0! Exit..." << endl;
+		return 1;
+	}
+	for(int k=0;k<(int)extra_steps.size();k++)
+		if(!(extra_steps[k] > 0.))
+		{
+			cout << "Bad extra step " << extra_steps[k] << ", need step > 0! Exit..." << endl;
+			return 1;
+		}
+	if(n_shards > 1 && !fixed_seed)
+	{
+		cout << "Sharded run without --seed, using the default seed "
+		     << run_seed << " in all shards" << endl;
+		fixed_seed = true;
+	}
+	if(!deposit_entropy && (dump_tables || average_profiles))
+	{
+		cout << "No entropy table is built, tables and averaged profiles are switched off" << endl;
+		dump_tables = false;
+		average_profiles = false;
+	}
+	if(!dump_tables)
+		extra_steps.clear();
+	if(compress_output && checkpoint_every > 0 && checkpoint_every%ecc_frame_events != 0)
+	{
+		//a checkpoint ends the current frame of every file (FrameWriter::sync()),
+		//so they are taken on the frame boundaries of the eccentricity file
+		checkpoint_every = (checkpoint_every/ecc_frame_events + 1)*ecc_frame_events;
+		cout << "Checkpoints every " << checkpoint_every
+		     << " events, a multiple of ecc_frame_events" << endl;
+	}
+	int first_event = (int)((long int)nevents*shard/n_shards);
+	int last_event = (int)((long int)nevents*(shard+1)/n_shards);
+
+	//checkpoint of this process, the run parameters come from it on resume
+	ostringstream checkpoint_filename_stream;
+	checkpoint_filename_stream << "data/Checkpoint_A_" << atom_num << ".dat";
+	Checkpoint checkpoint(outputName(checkpoint_filename_stream.str(), shard, n_shards));
+	int start_event = first_event;
+	if(resume)
+	{
+		if(!checkpoint.read())
+		{
+			cout << "No checkpoint " << checkpoint.getFilename() << " to resume from! Exit..." << endl;
+			return 1;
+		}
+		if(checkpoint.shard != shard || checkpoint.n_shards != n_shards
+		   || (fixed_seed && n_shards == 1 && checkpoint.run_seed != run_seed))
+		{
+			cout << "Checkpoint " << checkpoint.getFilename()
+			     << " belongs to a different run! Exit..." << endl;
+			return 1;
+		}
+		nevents = checkpoint.nevents;
+		run_seed = checkpoint.run_seed;
+		fixed_seed = checkpoint.fixed_seed;
+		first_event = (int)((long int)nevents*shard/n_shards);
+		last_event = (int)((long int)nevents*(shard+1)/n_shards);
+		start_event = checkpoint.next_event;
+		if(!checkpoint.truncateFiles())
+		{
+			cout << "Outputs do not match the checkpoint, cannot resume! Exit..." << endl;
+			return 1;
+		}
+		cout << "Resuming from event " << start_event+1 << endl;
+	}
+	checkpoint.run_seed = run_seed;
+	checkpoint.fixed_seed = fixed_seed;
+	checkpoint.nevents = nevents;
+	checkpoint.shard = shard;
+	checkpoint.n_shards = n_shards;
 
 
 	//open file for dumping eccentricity
@@ -74,38 +270,359 @@ int main()
 	ecc_filename_stream.str("");  //clean before using it
 	ecc_filename_stream << "data/Ecc_A_" << atom_num
 	                << "_order_" << ecc_order << ".dat";
-	ofstream ecc_of;
-	ecc_of.open(ecc_filename_stream.str().c_str(),std::ios_base::app);
+	if(compress_output)
+		ecc_filename_stream << ".gz";
+	FrameWriter ecc_writer(outputName(ecc_filename_stream.str(), shard, n_shards),
+		compress_output, true);
 
-	//composee file names for entropy density profiles
-	ostringstream sd_filename_stream;
+	//binary table of per-event summaries, see EventSummary.h; never compressed,
+	//its fixed-size records are read in place (binSummaryFile(), merge_shards)
+	ostringstream summary_filename_stream;
+	summary_filename_stream << "data/Summary_A_" << atom_num << ".bin";
+	string summary_filename = outputName(summary_filename_stream.str(), shard, n_shards);
+	ifstream summary_check(summary_filename.c_str());
+	bool summary_is_new = !summary_check.good() || summary_check.peek() == EOF;
+	summary_check.close();
+	FrameWriter summary_writer(summary_filename, false, true);
+	if(summary_is_new)
+		summary_writer.write(eventSummaryHeader());
 
-	for(int i=0;i<nevents;i++)
+	//per-event source lists, same layout rules as the summary table
+	FrameWriter* source_writer = 0;
+	bool source_is_new = false;   //header written with the first event
+	if(dump_sources)
 	{
-		mc_glauber* glauber_sim;   //create a MCG generator
-		glauber_sim = new mc_glauber(atom_num, impact_parameter, 
+		ostringstream name_stream;
+		name_stream << "data/Sources_A_" << atom_num << ".bin";
+		string source_filename = outputName(name_stream.str(), shard, n_shards);
+		ifstream source_check(source_filename.c_str());
+		source_is_new = !source_check.good() || source_check.peek() == EOF;
+		source_check.close();
+		source_writer = new FrameWriter(source_filename, false, true);
+	}
+
+	//online binning of the eccentricities
+	vector<double> npart_bins;
+	for(double edge=0.;edge<2.*atom_num+npart_bin_width;edge+=npart_bin_width)
+		npart_bins.push_back(edge);
+	BinAccumulator ecc_binning(npart_bins, SUMMARY_ORDERS);
+
+	//event-averaged profiles
+	vector<double> profile_classes;
+	for(double edge=0.;edge<2.*atom_num+profile_class_width;edge+=profile_class_width)
+		profile_classes.push_back(edge);
+	ProfileAccumulator* profile_average = 0;
+	if(average_profiles)
+		profile_average = new ProfileAccumulator(profile_classes,
 			sd_tbl_min, sd_tbl_max, sd_tbl_step);
+	if(resume)
+	{
+		istringstream state(checkpoint.state);
+		if(!ecc_binning.loadState(state)
+		   || (profile_average && !profile_average->loadState(state)))
+		{
+			cout << "Accumulators do not match the checkpoint, cannot resume! Exit..." << endl;
+			return 1;
+		}
+	}
+
+	//normalisation of the entropy density
+	Normalization* normalization = 0;
+	if(norm_table != "" || norm_fit_coef > 0.)
+	{
+		normalization = new Normalization(norm_to_target ? NORMALIZE_TARGET : NORMALIZE_SCALE);
+		if(norm_table == "")
+			normalization->setFit(norm_fit_coef, norm_fit_power);
+		else if(!normalization->readTable(norm_table))
+		{
+			cout << "Cannot read the normalisation table " << norm_table << "! Exit..." << endl;
+			return 1;
+		}
+	}
+
+	//compressed outputs keep all events of one kind in one file
+	FrameWriter* sd_writer = 0;
+	FrameWriter* nucleon_writer = 0;
+	if(compress_output && dump_tables)
+	{
+		ostringstream name_stream;
+		name_stream << "data/Sd_A_" << atom_num
+		            << (sparse_output ? "_sparse" : "") << ".dat.gz";
+		sd_writer = new FrameWriter(outputName(name_stream.str(), shard, n_shards),
+			true, resume);
+	}
+	vector<FrameWriter*> extra_sd_writers;   //one for each of extra_steps
+	for(int k=0;k<(int)extra_steps.size() && compress_output;k++)
+	{
+		ostringstream name_stream;
+		name_stream << "data/Sd_A_" << atom_num << "_step_" << extra_steps[k]
+		            << (sparse_output ? "_sparse" : "") << ".dat.gz";
+		extra_sd_writers.push_back(new FrameWriter(outputName(name_stream.str(), shard, n_shards),
+			true, resume));
+	}
+	if(compress_output && dump_nucleons)
+	{
+		ostringstream name_stream;
+		name_stream << "data/Nucleons_A_" << atom_num << ".dat.gz";
+		nucleon_writer = new FrameWriter(outputName(name_stream.str(), shard, n_shards),
+			true, resume);
+	}
 
-		glauber_sim->overlap();  //get binary collision
+	//live counters and timers, one JSON line per report
+	ofstream* instrument_of = 0;
+	string instrument_filename;
+	if(instrumentEnabled())
+	{
+		ostringstream name_stream;
+		name_stream << "data/Instrument_A_" << atom_num << ".jsonl";
+		instrument_filename = outputName(name_stream.str(), shard, n_shards);
+		instrument_of = new ofstream(instrument_filename.c_str(), std::ios_base::app);
+	}
+
+	//generator threads fill a pool of event slots, this thread writes the
+	//events in order, see EventQueue.h
+	MCGConfig config;
+	config.atom_num = atom_num;
+	config.impact_parameter = impact_parameter;
+	config.species = species;
+	config.species2 = species;
+	config.sd_tbl_min = sd_tbl_min;
+	config.sd_tbl_max = sd_tbl_max;
+	config.sd_tbl_step = sd_tbl_step;
+	config.run_seed = run_seed;
+	config.fixed_seed = fixed_seed;   //depends only on the run seed and the event number
+	config.collision_profile = collision_profile;
+	config.collision_opacity = collision_opacity;
+	config.hot_spots = hot_spots;
+	config.weight_shape = weight_shape;
+	config.normalization = normalization;
+	config.deposit_entropy = deposit_entropy;
+	config.align_order = align_order;
+	config.y_beam = y_beam;
+	config.verbose = false;   //the generator threads would interleave their lines,
+							  //the progress is printed below, in event order
+
+	//the outputs are formatted in the generator threads
+	EventHook format_event = [=](mc_glauber* glauber_sim, EventSlot* slot)
+	{
+		slot->text.resize(N_SLOT_TEXTS + extra_steps.size());
+		if(dump_tables)
+		{
+			ostringstream frame;
+			if(compress_output)
+				frame << "% event " << slot->event_id << endl;
+			if(sparse_output)
+				glauber_sim->writeSdTableSparse(frame);
+			else
+				glauber_sim->writeSdTable(frame);
+			slot->text[SLOT_SD] = frame.str();
+		}
+		for(int k=0;k<(int)extra_steps.size();k++)
+		{
+			SdTable table;
+			glauber_sim->resample(&table, extra_steps[k]);
+			ostringstream frame;
+			if(compress_output)
+				frame << "% event " << slot->event_id << endl;
+			if(sparse_output)
+				glauber_sim->writeSdTableSparse(frame, table);
+			else
+				glauber_sim->writeSdTable(frame, table);
+			slot->text[N_SLOT_TEXTS+k] = frame.str();
+		}
+		if(dump_nucleons)
+		{
+			ostringstream frame;
+			frame << "% event " << slot->event_id << endl;
+			glauber_sim->writeNucleonsCoordinates(frame);
+			slot->text[SLOT_NUCLEONS] = frame.str();
+		}
+		if(dump_sources)
+		{
+			SourceList sources;
+			sources.event_id = slot->event_id;
+			glauber_sim->fillSourceList(&sources);
+			slot->text[SLOT_SOURCE_HEADER] = sourceListHeader(glauber_sim->getAlpha(),
+				glauber_sim->getEntropyWidth());
+			slot->text[SLOT_SOURCES] = packSourceList(sources);
+		}
+		if(dump_3d)   //too large for the slot, goes to disk from here
+		{
+			ostringstream name_stream;
+			name_stream << "data/Sd3D_A_" << atom_num << "_event_" << slot->event_id << ".bin";
+			glauber_sim->dumpSd3D(name_stream.str(), eta_max, eta_step);
+		}
+		ostringstream ecc_line;
+		ecc_line << setw(8) << setprecision(5) << ecc_order
+		         << setw(15)<< setprecision(8) << glauber_sim->getEccentricity(ecc_order)
+		         << endl;
+		slot->text[SLOT_ECC] = ecc_line.str();
+	};
+	EventQueue event_queue(config, start_event+1, last_event,
+		generator_threads, event_slots, format_event);
+
+	//composee file names for entropy density profiles
+	ostringstream sd_filename_stream;
+
+	for(int i=start_event;i<last_event;i++)
+	{
+		EventSlot* slot = event_queue.next();   //event i+1
 
-		//prepare file name of the entropy density profile
-		sd_filename_stream.str("");
-		sd_filename_stream << "data/Sd_A_"<<atom_num
-		 				   << "_event_" << i+1 << ".dat";
 		//dump entropy density table 				   
-		glauber_sim->dumpSdTable(sd_filename_stream.str().c_str());  
+		if(dump_tables && compress_output)
+		{
+			sd_writer->write(slot->text[SLOT_SD]);
+			sd_writer->endFrame();   //compressed in the writer thread
+		}
+		else if(dump_tables)
+		{
+			//prepare file name of the entropy density profile
+			sd_filename_stream.str("");
+			sd_filename_stream << "data/Sd_A_"<<atom_num
+			 				   << "_event_" << i+1
+			                   << (sparse_output ? "_sparse.dat" : ".dat");
+			ofstream sd_of(sd_filename_stream.str().c_str());
+			sd_of << slot->text[SLOT_SD];
+			MCG_COUNT(CNT_BYTES_WRITTEN, (long int)slot->text[SLOT_SD].size());
+		}
+
+		//the same table at the other steps
+		for(int k=0;k<(int)extra_steps.size();k++)
+		{
+			const string& frame = slot->text[N_SLOT_TEXTS+k];
+			if(compress_output)
+			{
+				extra_sd_writers[k]->write(frame);
+				extra_sd_writers[k]->endFrame();
+				continue;
+			}
+			sd_filename_stream.str("");
+			sd_filename_stream << "data/Sd_A_" << atom_num << "_event_" << i+1
+			                   << "_step_" << extra_steps[k]
+			                   << (sparse_output ? "_sparse.dat" : ".dat");
+			ofstream sd_of(sd_filename_stream.str().c_str());
+			sd_of << frame;
+			MCG_COUNT(CNT_BYTES_WRITTEN, (long int)frame.size());
+		}
+
+		//dump nucleon positions
+		if(dump_nucleons)
+		{
+			if(compress_output)
+			{
+				nucleon_writer->write(slot->text[SLOT_NUCLEONS]);
+				nucleon_writer->endFrame();
+			}
+			else
+			{
+				sd_filename_stream.str("");
+				sd_filename_stream << "data/Nucleons_A_" << atom_num
+				                   << "_event_" << i+1 << ".dat";
+				ofstream nucleon_of(sd_filename_stream.str().c_str());
+				nucleon_of << slot->text[SLOT_NUCLEONS];
+			}
+		}
+
+		//dump wounded nucleons and binary collisions
+		if(source_writer)
+		{
+			if(source_is_new)
+			{
+				source_writer->write(slot->text[SLOT_SOURCE_HEADER]);
+				source_is_new = false;
+			}
+			source_writer->write(slot->text[SLOT_SOURCES]);
+			source_writer->endFrame();
+		}
 
 		//dump eccentricity
-		ecc_of << setw(8) << setprecision(5) << ecc_order
-		       << setw(15)<< setprecision(8) << glauber_sim->getEccentricity(ecc_order)
-		       << endl;  
+		ecc_writer.write(slot->text[SLOT_ECC]);
+		if((i+1-first_event)%ecc_frame_events == 0)
+			ecc_writer.endFrame();
+
+		//dump event summary
+		const EventSummary& summary = slot->summary;
+		summary_writer.write(packEventSummary(summary));
+		summary_writer.endFrame();
+		if(bin_by_npart)
+			ecc_binning.add(summary.npart, summary.ecc);
+		if(profile_average && align_order > 0)   //born centred, and along Psi_2 for order 2
+			profile_average->add(summary.npart, slot->grid, 0., 0.,
+				(rotate_profiles && align_order != 2) ? summary.psi[0] : 0.);
+		else if(profile_average)
+			profile_average->add(summary.npart, slot->grid,
+				summary.x_cm, summary.y_cm, rotate_profiles ? summary.psi[0] : 0.);
+
+		MCG_COUNT(CNT_EVENTS, 1);
+		if(instrument_of && (i+1-first_event)%instrument_every == 0)
+			instrumentReport(*instrument_of);
+
+		cout << "Number of participants: " << summary.npart
+		     << ", binary collisions: " << summary.ncoll << endl
+		     << "Loop " << i+1 << " completed!" << endl << endl;
 
-		//clean up before next loop
-		delete glauber_sim;
-		cout << "Loop " << i+1 << " completed!" << endl << endl << endl;
+		//the slot goes back to the generators
+		event_queue.release(slot);
+
+		if(checkpoint_every > 0
+		   && ((i+1-first_event)%checkpoint_every == 0 || i+1 == last_event))
+		{
+			checkpoint.next_event = i+1;
+			checkpoint.clearFiles();
+			checkpointWriter(checkpoint, &ecc_writer);
+			checkpointWriter(checkpoint, &summary_writer);
+			checkpointWriter(checkpoint, source_writer);
+			checkpointWriter(checkpoint, sd_writer);
+			for(int k=0;k<(int)extra_sd_writers.size();k++)
+				checkpointWriter(checkpoint, extra_sd_writers[k]);
+			checkpointWriter(checkpoint, nucleon_writer);
+			if(instrument_of)
+			{
+				instrument_of->flush();
+				checkpoint.addFile(instrument_filename);
+			}
+			ostringstream state;
+			ecc_binning.saveState(state);
+			if(profile_average)
+				profile_average->saveState(state);
+			checkpoint.state = state.str();
+			checkpoint.write();
+		}
 	}
 
-	ecc_of.close();  //finish eccentricity output file
+	ecc_writer.close();  //finish eccentricity output file
+	summary_writer.close();
+	if(bin_by_npart)
+	{
+		ostringstream binned_filename_stream;
+		binned_filename_stream << "data/Ecc_binned_Npart_A_" << atom_num << ".dat";
+		ofstream binned_of(outputName(binned_filename_stream.str(), shard, n_shards).c_str());
+		binned_of << "% Npart_min Npart_max count dN/dNpart, then for eps_2 ~ eps_"
+		          << SUMMARY_ORDERS+1 << ": <e> <e^2> <e^4> e{2} e{4}" << endl;
+		ecc_binning.write(binned_of);
+	}
+	if(profile_average)
+	{
+		ostringstream profile_prefix_stream;
+		profile_prefix_stream << "data/Sd_average_A_" << atom_num;
+		profile_average->write(outputName(profile_prefix_stream.str(), shard, n_shards));
+		delete profile_average;
+	}
+	if(normalization)
+		delete normalization;
+	if(source_writer)
+		delete source_writer;
+	if(sd_writer)
+		delete sd_writer;   //flushes the remaining frames
+	for(int k=0;k<(int)extra_sd_writers.size();k++)
+		delete extra_sd_writers[k];
+	if(nucleon_writer)
+		delete nucleon_writer;
+	if(instrument_of)  //final report includes the flushed output
+	{
+		instrumentReport(*instrument_of);
+		delete instrument_of;
+	}
 
 	return 0;
 }
\ No newline at end of file
@@ -10,30 +10,107 @@ Version: 1.0
 Purpose: Manipulate nucleus and Simulate collision
 1. Use Nucleus class to create nucleus;
 2. overlap() can simulate colllisions and count the number of wounded
-   nucleons and binary collisions; 
-3. hit() function controls collision;
+   nucleons and binary collisions; it runs the stages generateNuclei(),
+   findCollisions(), findActiveWindow() and distEntropy() in turn;
+   the two nuclei may differ, e.g. p+Pb with Atom_num2=1; nuclei that
+   miss each other are sampled again, such a configuration is no event;
+3. hit() function controls collision for the black disk; the gray and
+   Gaussian profiles (setCollisionProfile()) accept a pair within the
+   cutoff radius with probability P(b), drawing from a per-event stream
+   in batches. Only pairs within the cutoff are tested: nucleus 2 is
+   sorted in x, so each nucleon of nucleus 1 scans a narrow strip;
+   with setHotSpots() every nucleon is made of N_spots hot spots at
+   Gaussian distances around its center (recentred on it); spots collide
+   with the same profile, found through a cell list of the spots of
+   nucleus 2, and the entropy sources are the wounded spots and the
+   spot-spot collisions. A nucleon is wounded if one of its spots is,
+   Ncoll counts the nucleon pairs with at least one spot-spot collision;
 4. distEntropy() collects entropy generated by collisions. The radius, 
    glauber_entropy_width, is specify by user in this code. While superMC 
    chooses this parameters in a way to reproduce the nucleon-nucleon collision 
    cross-section;
-5. dumpSdTable() dumps entropy profile;
+5. dumpSdTable() dumps entropy profile, either the full table or only the
+   active window around the sources (findActiveWindow());
+   dumpSdTableSparse() keeps only the nonzero cells;
 6. findSdCM() finds the center of the profile;
 6. getEccentricity() firstly calls findSdCM() to find the center of the profile,
    recenter it, then calculates eccentricity to any given order.
+7. setWeightFluctuations(k) multiplies the entropy of every source by a
+   gamma-distributed factor of mean 1 and variance 1/k; all factors of an
+   event are drawn at once (sampleGamma()), after the collision search,
+   and are used by the table and by the moments without it;
+8. setNormalization() multiplies all weights by a factor that depends on
+   Npart (and on the entropy for a target), see Normalization.h, right
+   after the collision search; the written table is then normalised;
+9. With setDepositEntropy(false) no table is built; the center, <r^2> and
+   eccentricities are then integrated analytically over the hard disks
+   around the sources: exact for the center, the numerators and the
+   denominators of even orders, odd denominators use a small quadrature
+   over the disk. fillSourceList() gives the sources themselves.
+10. One object can run overlap() for many events: the sources of the
+   previous event are dropped first, the table buffer is kept; the CDF
+   tables of the nuclei are shared by the whole process (NuclearData.h). setSdBuffer() lets the table live in a buffer of the caller.
+11. resample() gives the event at another step without running it again:
+   conservative block averages of the table for odd multiples of the
+   step if it was deposited for this event, otherwise the sources deposited anew (finer grids); deposits
+   scatter every source onto the cells of its disk only.
+12. dumpSd3D() extends the table in eta_s: a wounded nucleon of nucleus 1
+   (2) is weighted by 1+eta_s/y_beam (1-eta_s/y_beam), within [0,2], a
+   binary collision by 1, all times a plateau of half width eta_plateau
+   with Gaussian tails of width eta_width (setLongitudinalProfile());
+   the slice eta_s = 0 is the usual table. The file is written one eta_s
+   slab at a time, so memory does not grow with the eta_s grid:
+     8 bytes "MCGSD3D\0", int32 nx, ny, n_eta, 0,
+     float64 x_lower, y_lower, step, eta_lower, eta_step,
+     then n_eta slabs of nx*ny float32, row-major like the table.
+13. With setAlignment(n) the event is recentred on the center of its
+   sources and rotated by -Psi_n right before deposition, so the table
+   is born aligned; the summary, eccentricities, source list and nucleon
+   positions all describe the aligned event (center ~ 0, Psi_n ~ 0 up to
+   the grid), getAlignment() gives the applied shift and angle. All
+   Psi_n are then given in -pi/n ~ pi/n (wrapPsi()), other orders
+   Psi_m - Psi_n of the unaligned event, and alignSources() warns if
+   the aligned sources do not give Psi_n = 0.
+14. The deposit and the moments run through the kernels of SdKernels.h,
+   compiled for the production grid (-13 ~ 13 fm at 0.1) and for any
+   other square grid, picked per table. The center is found in one pass
+   over the window, then <r^2> and the moments of all orders 2 ~
+   SUMMARY_ORDERS+1 in a second one; both are kept until the table
+   changes, so fillEventSummary() and later getEccentricity() calls do
+   not sweep the table again. Other orders use the generic loop;
+   setGenericKernels(true) uses the generic loops for everything and
+   setRuntimeGrid(true) the kernels of the run-time grid, e.g. to
+   compare them.
+15. setSpecies() takes the measured Woods-Saxon radius, diffuseness,
+   deformation and hard core of a species from NuclearData.h; by default
+   both nuclei keep R = 1.25 A^1/3 fm, a = 0.5 fm as before.
 */
 
 
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <cstdio>
+#include <stdint.h>
 #include "mc_glauber.h"
+#include "SdKernels.h"
 
 using namespace std; 
 
+extern unsigned long int random_seed ();   // routine to generate a seed
+
+const int uniform_batch_size = 256;   //uniforms drawn at once for the collision test
+const double collision_p_min = 1e-6;   //Gaussian tail below this is cut off
+static const char sd_3d_magic[8] = {'M','C','G','S','D','3','D','\0'};
+
 mc_glauber::mc_glauber(int Atom_num, double Impact_parameter, 
-			double Sd_tbl_min, double Sd_tbl_max, double Sd_tbl_step)
+			double Sd_tbl_min, double Sd_tbl_max, double Sd_tbl_step, int Atom_num2,
+			bool Verbose)
 {	
+	verbose = Verbose;
 	atom_num = Atom_num;    //read in atomic number
+	atom_num2 = (Atom_num2 > 0) ? Atom_num2 : Atom_num;   //same nuclei by default
 	impact_parameter = Impact_parameter;    //assign impact parameters
 	//parameter for entropy density profile
 	alpha = 0.3;   //weight of wounded nucleon
@@ -44,37 +121,88 @@ mc_glauber::mc_glauber(int Atom_num, double Impact_parameter,
 	sd_tbl_step = Sd_tbl_step;
 	max_sd_tbl = (int)((sd_tbl_upper-sd_tbl_lower)/sd_tbl_step+0.1)+1;
 	entropy_density = 0; //not assigned value
+	deposit_entropy = true;
+	sd_valid = false;
+	total_entropy = 0.;
+	npart = 0; ncoll = 0;
+	win_i_min = 0; win_i_max = max_sd_tbl-1;  //full table until sources are known
+	win_j_min = 0; win_j_max = max_sd_tbl-1;
 	glauber_entropy_width = 0.7;  //width for collecting entropy
 								  //
+	collision_profile = COLLISION_BLACK_DISK;
+	collision_opacity = 1.;
+	collision_rng = 0;
+	has_collision_seed = false;
+	event_seed = 0;
+	has_event_seed = false;
+	uniform_pos = 0;
+	weight_shape = 0.;
+	normalization = 0;
+	sd_scale = 1.;
+	n_spots = 0;
+	spot_width = 0.;
+	spot_diameter = 0.;
+	for(int k=0;k<3;k++)
+		sd_parts[k] = 0;
+	generic_kernels = false;
+	runtime_grid = false;
+	sd_coord.resize(max_sd_tbl);
+	for(int i=0;i<max_sd_tbl;i++)
+		sd_coord[i] = sd_tbl_lower + i*sd_tbl_step;
+	forgetMoments();
+	align_order = 0;
+	align_x = 0.; align_y = 0.; align_psi = 0.;
+	y_beam = 8.;   //LHC, 2.76 TeV
+	eta_plateau = 1.;
+	eta_width = 1.3;
 
-	cout << "***********************************************" << endl
-	     << "Monte-Carlo Glauber Model" << endl;
+	if(verbose)
+		cout << "***********************************************" << endl
+		     << "Monte-Carlo Glauber Model" << endl;
 
 	//construct new nuclei
-	Nuc1 = new Nucleus(atom_num);
-	Nuc2 = new Nucleus(atom_num);
+	Nuc1 = new Nucleus(atom_num, 0.4, 0.4, 0, verbose);
+	Nuc2 = new Nucleus(atom_num2, 0.4, 0.4, 0, verbose);
 }
 
 mc_glauber::~mc_glauber()
+{
+	clearSources();
+
+	if(entropy_density)
+		delete entropy_density;
+	for(int k=0;k<3;k++)
+		if(sd_parts[k])
+			delete sd_parts[k];
+
+	delete Nuc1;
+	delete Nuc2;
+	if(verbose)
+		cout << "***********************************************" << endl;
+}
+
+void mc_glauber::clearSources()
 {
 	for(int i=0;i<(int)wn_coordinates.size();i++)
 		delete wn_coordinates[i];
-    wn_coordinates.clear();
+	wn_coordinates.clear();
+	wn_nucleus.clear();
 
- 	for(int i=0;i<(int)bc_coordinates.size();i++)
+	for(int i=0;i<(int)bc_coordinates.size();i++)
 		delete bc_coordinates[i];
-    bc_coordinates.clear();  
-
-    if(entropy_density)
-    {
-    	for(int i=0;i<max_sd_tbl;i++)
-     		delete [] entropy_density[i];
-     	delete [] entropy_density;    	
-    }
+	bc_coordinates.clear();
+	wn_weight.clear();
+	bc_weight.clear();
+	sd_valid = false;   //the table, if any, is of the previous event
+}
 
-	delete Nuc1;
-	delete Nuc2;
-	cout << "***********************************************" << endl;
+void mc_glauber::setSdBuffer(sd_real* Buffer, long int Capacity)
+{
+	if(entropy_density == 0)
+		entropy_density = new SdTable();
+	entropy_density->attach(Buffer, Capacity);
+	forgetMoments();
+	sd_valid = false;   //not filled until the next distEntropy()
 }
 
 bool mc_glauber::hit(double rp, double x0, double y0, double x1, double y1)
@@ -87,8 +215,314 @@ bool mc_glauber::hit(double rp, double x0, double y0, double x1, double y1)
 } 
 
 
+void mc_glauber::setVerbose(bool Verbose)
+{
+	verbose = Verbose;
+	Nuc1->setVerbose(verbose);
+	Nuc2->setVerbose(verbose);
+}
+
+void mc_glauber::setEventSeed(unsigned long int seed)
+{
+	//two decorrelated seeds from one (splitmix64 finalizer)
+	for(int k=1;k<=2;k++)
+	{
+		unsigned long long z = (unsigned long long)seed + k*0x9E3779B97F4A7C15ULL;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		z = z ^ (z >> 31);
+		if(k == 1)
+			Nuc1->setSeed((unsigned long int)z);
+		else
+			Nuc2->setSeed((unsigned long int)z);
+	}
+	collision_rng = (unsigned long long)seed + 3*0x9E3779B97F4A7C15ULL;
+	has_collision_seed = true;
+	event_seed = seed;
+	has_event_seed = true;
+}
+
+void mc_glauber::setCollisionProfile(int Profile, double Opacity)
+{
+	if(Profile < COLLISION_BLACK_DISK || Profile > COLLISION_GAUSSIAN
+	   || !(Opacity > 0.) || Opacity > 1.)
+	{
+		cout << "Unknown collision profile " << Profile << " with opacity "
+		     << Opacity << "! Exit..." << endl;
+		exit(-1);
+	}
+	collision_profile = Profile;
+	collision_opacity = Opacity;
+}
+
+void mc_glauber::refillUniforms()
+{
+	//splitmix64, 53 random bits per double in [0, 1)
+	uniform_batch.resize(uniform_batch_size);
+	for(int k=0;k<uniform_batch_size;k++)
+	{
+		unsigned long long z = (collision_rng += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		z = z ^ (z >> 31);
+		uniform_batch[k] = (z >> 11) * (1./9007199254740992.);
+	}
+	uniform_pos = 0;
+	MCG_COUNT(CNT_RNG_DRAWS, uniform_batch_size);
+}
+
+void mc_glauber::setHotSpots(int N_spots, double Spot_width, double Spot_diameter,
+	double Entropy_width)
+{
+	if(N_spots < 0 || Spot_width < 0. || !(Spot_diameter > 0.) || !(Entropy_width > 0.))
+	{
+		cout << "Bad hot spot parameters! Exit..." << endl;
+		exit(-1);
+	}
+	n_spots = N_spots;
+	spot_width = Spot_width;
+	spot_diameter = Spot_diameter;
+	if(n_spots > 0)
+		glauber_entropy_width = Entropy_width;
+}
+
+void mc_glauber::setWeightFluctuations(double Shape)
+{
+	if(Shape < 0.)
+	{
+		cout << "Gamma shape " << Shape << " is negative! Exit..." << endl;
+		exit(-1);
+	}
+	weight_shape = Shape;
+}
+
+void mc_glauber::setSpecies(string Species1, string Species2)
+{
+/*
+replace the nuclei by nuclei with the parameters of a species (radius,
+diffuseness, deformation, hard core); the species must have the atomic
+number of its nucleus, "" keeps the default parameters of that nucleus
+*/
+	for(int n=1;n<=2;n++)
+	{
+		string species = (n == 1) ? Species1 : Species2;
+		if(species == "")
+			continue;
+		WoodsSaxonParams params;
+		if(!findWoodsSaxonParams(species, &params))
+		{
+			cout << "Unknown species " << species << "! Known are: ";
+			listWoodsSaxonSpecies(cout);
+			exit(-1);
+		}
+		Nucleus*& nucleus = (n == 1) ? Nuc1 : Nuc2;
+		delete nucleus;
+		nucleus = new Nucleus((n == 1) ? atom_num : atom_num2, 0.4, 0.4, &params, verbose);
+	}
+}
+
+void mc_glauber::setLongitudinalProfile(double Y_beam, double Eta_plateau, double Eta_width)
+{
+	if(Y_beam <= 0. || Eta_plateau < 0. || Eta_width <= 0.)
+	{
+		cout << "Longitudinal profile needs Y_beam > 0, Eta_plateau >= 0 and Eta_width > 0! Exit..." << endl;
+		exit(-1);
+	}
+	y_beam = Y_beam;
+	eta_plateau = Eta_plateau;
+	eta_width = Eta_width;
+}
+
+double mc_glauber::longitudinalProfile(int nucleus, double eta)
+{
+	double envelope = 1.;
+	double tail = fabs(eta) - eta_plateau;
+	if(tail > 0.)
+		envelope = exp(-tail*tail/(2.*eta_width*eta_width));
+	if(nucleus == 1)   //moves towards positive eta_s
+		return envelope*min(2., max(0., 1. + eta/y_beam));
+	if(nucleus == 2)
+		return envelope*min(2., max(0., 1. - eta/y_beam));
+	return envelope;
+}
+
+void mc_glauber::sampleGamma(double shape, double* out, int n)
+{
+/*
+Marsaglia-Tsang for all n variates together: every pass draws a normal
+and a uniform for each variate still open, tests them in one loop and
+keeps the rejected ones (a few percent) for the next pass. shape < 1 is
+boosted: gamma(k) = gamma(k+1)*U^(1/k).
+*/
+	double k = (shape < 1.) ? shape + 1. : shape;
+	double d = k - 1./3., c = 1./sqrt(9.*d);
+	vector<int> open(n);
+	for(int i=0;i<n;i++)
+		open[i] = i;
+	vector<double> z(n), u(n);
+	while(!open.empty())
+	{
+		int m = open.size();
+		for(int i=0;i<m;i+=2)   //Box-Muller, two normals per pair of uniforms
+		{
+			double r = sqrt(-2.*log(1. - nextUniform()));
+			double phi = 2.*M_PI*nextUniform();
+			z[i] = r*cos(phi);
+			if(i+1 < m)
+				z[i+1] = r*sin(phi);
+		}
+		for(int i=0;i<m;i++)
+			u[i] = nextUniform();
+		int n_rejected = 0;
+		for(int i=0;i<m;i++)
+		{
+			double v = 1. + c*z[i];
+			v = v*v*v;
+			if(v > 0. && log(u[i]) < 0.5*z[i]*z[i] + d - d*v + d*log(v))
+				out[open[i]] = d*v;
+			else
+				open[n_rejected++] = open[i];
+		}
+		open.resize(n_rejected);
+	}
+	if(shape < 1.)
+		for(int i=0;i<n;i++)
+			out[i] *= pow(nextUniform(), 1./shape);
+}
+
+void mc_glauber::drawSourceWeights()
+{
+	int n_wn = wn_coordinates.size(), n_bc = bc_coordinates.size();
+	wn_weight.assign(n_wn, alpha);
+	bc_weight.assign(n_bc, 1.-alpha);
+	if(weight_shape <= 0. || n_wn + n_bc == 0)
+		return;
+	vector<double> factor(n_wn + n_bc);
+	sampleGamma(weight_shape, &factor[0], n_wn + n_bc);
+	for(int k=0;k<n_wn;k++)   //mean 1
+		wn_weight[k] *= factor[k]/weight_shape;
+	for(int k=0;k<n_bc;k++)
+		bc_weight[k] *= factor[n_wn+k]/weight_shape;
+}
+
+void mc_glauber::normalizeSources()
+{
+	double weight = 0.;
+	for(int k=0;k<(int)wn_weight.size();k++)
+		weight += wn_weight[k];
+	for(int k=0;k<(int)bc_weight.size();k++)
+		weight += bc_weight[k];
+	double entropy = weight*M_PI*glauber_entropy_width*glauber_entropy_width;
+	sd_scale = normalization->getScale(npart, entropy);
+	for(int k=0;k<(int)wn_weight.size();k++)
+		wn_weight[k] *= sd_scale;
+	for(int k=0;k<(int)bc_weight.size();k++)
+		bc_weight[k] *= sd_scale;
+	if(verbose)
+		cout << "Entropy density normalised by a factor of " << sd_scale << endl;
+}
+
+void mc_glauber::alignSources()
+{
+/*
+center and participant plane from the sources (exact disk integrals,
+the same moments as without a table); every position of the event,
+sources, hot spots and nucleons, is shifted and rotated by -Psi_n
+*/
+	findSourceCM(&align_x, &align_y);
+	double ecc;
+	findSourceEccentricity(align_order, &ecc, &align_psi);
+	double cos_psi = cos(align_psi), sin_psi = sin(align_psi);
+	for(int n=0;n<2;n++)
+	{
+		vector<Coordinates*>& sources = (n == 0) ? wn_coordinates : bc_coordinates;
+		for(int k=0;k<(int)sources.size();k++)
+		{
+			double x = sources[k]->getX() - align_x;
+			double y = sources[k]->getY() - align_y;
+			sources[k]->setX(cos_psi*x + sin_psi*y);
+			sources[k]->setY(-sin_psi*x + cos_psi*y);
+		}
+		HotSpots& spots = (n == 0) ? spots1 : spots2;
+		for(int a=0;a<(int)spots.x.size();a++)
+		{
+			double x = spots.x[a] - align_x;
+			double y = spots.y[a] - align_y;
+			spots.x[a] = cos_psi*x + sin_psi*y;
+			spots.y[a] = -sin_psi*x + cos_psi*y;
+		}
+		Nucleus* nucleus = (n == 0) ? Nuc1 : Nuc2;
+		nucleus->shiftNucleus(align_x, align_y);
+		nucleus->rotateNucleus(-align_psi);
+	}
+	double psi_aligned;   //check: the aligned sources have Psi_n = 0
+	findSourceEccentricity(align_order, &ecc, &psi_aligned);
+	if(fabs(wrapPsi(psi_aligned, align_order)) > 1e-6)
+		cout << "Warning: aligned sources have Psi_" << align_order << " = "
+		     << wrapPsi(psi_aligned, align_order) << ", not 0" << endl;
+	if(verbose)
+		cout << "Sources recentred by (" << align_x << ", " << align_y
+		     << ") and rotated by " << -align_psi << endl;
+}
+
+double mc_glauber::collisionCutoff(double d)
+{
+	//black disk: sigma = pi*d^2
+	if(collision_profile == COLLISION_GRAY_DISK)
+		return d/sqrt(collision_opacity);
+	if(collision_profile == COLLISION_GAUSSIAN)
+		return d*sqrt(log(collision_opacity/collision_p_min)/collision_opacity);
+	return d;
+}
+
+double mc_glauber::collisionProbability(double b2, double d)
+{
+	if(collision_profile == COLLISION_GAUSSIAN)
+		return collision_opacity*exp(-collision_opacity*b2/(d*d));
+	return collision_opacity;   //gray disk, inside the cutoff
+}
+
 void mc_glauber::overlap()
 {
+	clearSources();   //the object may be reused for the next event
+	generateNuclei();   //sample both nuclei and shift them apart
+	findCollisions();   //count wounded nucleons and binary collisions
+	unsigned long int seed = event_seed;   //the seed of this event, kept as given
+	for(unsigned long long attempt=1;ncoll==0;attempt++)
+	{
+		//no inelastic collision is not an event: sample again, from a
+		//stream that still only depends on the event seed
+		if(attempt > 1000)
+		{
+			cout << "No collision in 1000 samples at b=" << impact_parameter
+			     << " fm, collisions are (nearly) impossible! Exit..." << endl;
+			exit(-1);
+		}
+		if(has_event_seed)
+		{
+			setEventSeed(seed ^ (attempt*0xD1B54A32D192ED03ULL));
+			event_seed = seed;   //setEventSeed(seed) replays this event, retries included
+		}
+		generateNuclei();
+		findCollisions();
+	}
+	has_event_seed = false;   //a seed is used for one event only, retries included
+	if(normalization)
+		normalizeSources();
+	else
+		sd_scale = 1.;   //no factor of an earlier normalised event
+	if(align_order > 0)
+		alignSources();
+	if(deposit_entropy)
+	{
+		findActiveWindow();
+		distEntropy();
+	}
+}
+
+void mc_glauber::generateNuclei()
+{
+	MCG_TIMER(TMR_SAMPLING);
 	double nuc_size_1 = Nuc1->getNucleonSize();
 	double nuc_size_2 = Nuc2->getNucleonSize();
 
@@ -100,7 +534,6 @@ void mc_glauber::overlap()
 
 	// cout << "Nucleon size is: " << nuc_size_1 << endl;
 
-	long int binary_collision_num=0;
 	//generate nucleus configuration
 	Nuc1->generateConfiguration();
 	Nuc2->generateConfiguration();
@@ -108,41 +541,91 @@ void mc_glauber::overlap()
 	//shift centers of nuclei in the x-direction
 	Nuc1->shiftNucleus(impact_parameter/2.);
 	Nuc2->shiftNucleus(-impact_parameter/2.);
+}
+
+void mc_glauber::findCollisions()
+{
+	if(n_spots > 0)
+	{
+		findHotSpotCollisions();
+		return;
+	}
+	MCG_TIMER(TMR_COLLISION);
+	double nuc_size_1 = Nuc1->getNucleonSize();
+	long int binary_collision_num=0;
+	long int pair_tests=0;
 
+	bool black_disk = (collision_profile == COLLISION_BLACK_DISK);
+	if((!black_disk || weight_shape > 0.) && !has_collision_seed)
+		collision_rng = random_seed();
+	has_collision_seed = false;   //a seed is used for one event only
+	uniform_pos = uniform_batch.size();   //no uniforms left from another event
+	double cutoff = collisionCutoff(2.*nuc_size_1);
+	double cutoff2 = cutoff*cutoff;
+
+	//nucleus 2 sorted in x: only a strip of width 2*cutoff can be hit
+	vector<pair<double,int> > x2_order(atom_num2);
+	vector<double> x2(atom_num2), y2(atom_num2);
+	for(int j=0;j<atom_num2;j++)
+	{
+		double z1;
+		Nuc2->getNucleonCoordinates(j, &x2[j], &y2[j], &z1);
+		x2_order[j] = make_pair(x2[j], j);
+	}
+	sort(x2_order.begin(), x2_order.end());
+
+	vector<int> hits;   //partners of one nucleon, in the order of the full loop
 	for(int i=0;i<atom_num;i++)
-		for(int j=0;j<atom_num;j++)
-		{
-			//get the position of two 
-			double x0, y0, z0;
-			double x1, y1, z1;
-			Nuc1->getNucleonCoordinates(i, &x0, &y0, &z0);
-			Nuc2->getNucleonCoordinates(j, &x1, &y1, &z1);
+	{
+		double x0, y0, z0;
+		Nuc1->getNucleonCoordinates(i, &x0, &y0, &z0);
 
+		hits.clear();
+		vector<pair<double,int> >::iterator it = lower_bound(x2_order.begin(),
+			x2_order.end(), make_pair(x0 - cutoff - 1e-12, -1));
+		for(;it!=x2_order.end() && it->first <= x0 + cutoff + 1e-12;it++)
+		{
+			int j = it->second;
+			pair_tests++;
 			bool hit_here;
-			hit_here = hit(nuc_size_1, x0, y0, x1, y1);
-			if(hit_here == true)
+			if(black_disk)
+				hit_here = hit(nuc_size_1, x0, y0, x2[j], y2[j]);
+			else
 			{
-				binary_collision_num++;
-				Nuc1->setNucleonBinaryCollision(i);
-				Nuc2->setNucleonBinaryCollision(j);
-
-				//position of binary collison
-				double bc_x = (x0 + x1)/2.;
-				double bc_y = (y0 + y1)/2.;
-
-				//store binary collision positions debug
-				Coordinates* ptr;
-				ptr = new Coordinates(bc_x, bc_y);
-				bc_coordinates.push_back(ptr);				
+				double b2 = (x0 - x2[j])*(x0 - x2[j]) + (y0 - y2[j])*(y0 - y2[j]);
+				hit_here = b2 <= cutoff2 && nextUniform() < collisionProbability(b2, 2.*nuc_size_1);
 			}
-		}//<-> for i=0:atom_num-1		
+			if(hit_here == true)
+				hits.push_back(j);
+		}
+		sort(hits.begin(), hits.end());
+
+		for(int k=0;k<(int)hits.size();k++)
+		{
+			int j = hits[k];
+			binary_collision_num++;
+			Nuc1->setNucleonBinaryCollision(i);
+			Nuc2->setNucleonBinaryCollision(j);
+
+			//position of binary collison
+			double bc_x = (x0 + x2[j])/2.;
+			double bc_y = (y0 + y2[j])/2.;
+
+			//store binary collision positions debug
+			Coordinates* ptr;
+			ptr = new Coordinates(bc_x, bc_y);
+			bc_coordinates.push_back(ptr);
+		}
+	}//<-> for i=0:atom_num-1
+	MCG_COUNT(CNT_PAIR_TESTS, pair_tests);
+	MCG_COUNT(CNT_HITS, binary_collision_num);
 
 	//loop over to find all wounded nucleons
 	long int counts1=0; 
 	long int counts2=0;
-	for(int i=0;i<atom_num;i++)
+	for(int i=0;i<max(atom_num, atom_num2);i++)
     {
-    	if(Nuc1->getNucleonBCNum(i)>0)
+    	if(i<atom_num && Nuc1->getNucleonBCNum(i)>0)
     	{
     		counts1++;   //# of wounded nucleon in nucleus1 +1
 
@@ -152,9 +635,10 @@ void mc_glauber::overlap()
     		Nuc1->getNucleonCoordinates(i, &wn_x, &wn_y, &z);
 			ptr = new Coordinates(wn_x, wn_y);
 			wn_coordinates.push_back(ptr);
+			wn_nucleus.push_back(1);
     	}
 
-    	if(Nuc2->getNucleonBCNum(i)>0)
+    	if(i<atom_num2 && Nuc2->getNucleonBCNum(i)>0)
     	{
     		counts2++;   //# of wounded nucleon in nucleus2 +1
 
@@ -164,23 +648,212 @@ void mc_glauber::overlap()
     		Nuc2->getNucleonCoordinates(i, &wn_x, &wn_y, &z);
 			ptr = new Coordinates(wn_x, wn_y);
 			wn_coordinates.push_back(ptr);
+			wn_nucleus.push_back(2);
     	}
 	}
-	//no collision at all
-	if(binary_collision_num ==0)
-	{
+	//no collision at all, overlap() samples the nuclei again
+	if(binary_collision_num ==0 && verbose)
 		cout << "No binary collsion!" << endl;
-		exit(0);
-	}		    
 
 	// cout << "Collison process complete!" << endl
 	//      << "Number of participants in nucleus 1: "<< counts1 << endl
 	//      << "Number of participants in nucleus 2: "<< counts2 << endl;
-	cout << "Number of participants: " << counts1+counts2 << endl
-		 << "Total binary collision: " << binary_collision_num<<endl;
-    distEntropy();
+	npart = counts1 + counts2;
+	ncoll = binary_collision_num;
+	if(verbose)
+		cout << "Number of participants: " << counts1+counts2 << endl
+			 << "Total binary collision: " << binary_collision_num<<endl;
+	drawSourceWeights();
+}
+
+void mc_glauber::sampleHotSpots(Nucleus* nucleus, int n_nucleons, HotSpots* spots)
+{
+	spots->clear();
+	spots->x.reserve((long int)n_nucleons*n_spots);
+	spots->y.reserve((long int)n_nucleons*n_spots);
+	spots->nucleon.reserve((long int)n_nucleons*n_spots);
+	spots->n_coll.assign((long int)n_nucleons*n_spots, 0);
+	for(int i=0;i<n_nucleons;i++)
+	{
+		double x0, y0, z0;
+		nucleus->getNucleonCoordinates(i, &x0, &y0, &z0);
+		int first = spots->x.size();
+		double x_mean = 0., y_mean = 0.;
+		for(int k=0;k<n_spots;k++)
+		{
+			//Box-Muller: a Gaussian displacement in the plane from two uniforms
+			double r = spot_width*sqrt(-2.*log(1. - nextUniform()));
+			double phi = 2.*M_PI*nextUniform();
+			spots->x.push_back(r*cos(phi));
+			spots->y.push_back(r*sin(phi));
+			spots->nucleon.push_back(i);
+			x_mean += r*cos(phi)/n_spots;
+			y_mean += r*sin(phi)/n_spots;
+		}
+		for(int k=first;k<first+n_spots;k++)   //center of the spots on the nucleon
+		{
+			spots->x[k] += x0 - x_mean;
+			spots->y[k] += y0 - y_mean;
+		}
+	}
+}
+
+void mc_glauber::findHotSpotCollisions()
+{
+	MCG_TIMER(TMR_COLLISION);
+	if(!has_collision_seed)
+		collision_rng = random_seed();
+	has_collision_seed = false;   //a seed is used for one event only
+	uniform_pos = uniform_batch.size();
+	sampleHotSpots(Nuc1, atom_num, &spots1);
+	sampleHotSpots(Nuc2, atom_num2, &spots2);
+
+	bool black_disk = (collision_profile == COLLISION_BLACK_DISK);
+	double cutoff = collisionCutoff(spot_diameter);
+	double cutoff2 = cutoff*cutoff;
+
+	//cell list of the spots of nucleus 2, cells of size cutoff: the
+	//partners of a spot are in its own cell and the 8 around it
+	int n1 = spots1.x.size(), n2 = spots2.x.size();
+	double x_min = spots2.x[0], x_max = spots2.x[0];
+	double y_min = spots2.y[0], y_max = spots2.y[0];
+	for(int b=1;b<n2;b++)
+	{
+		x_min = min(x_min, spots2.x[b]); x_max = max(x_max, spots2.x[b]);
+		y_min = min(y_min, spots2.y[b]); y_max = max(y_max, spots2.y[b]);
+	}
+	int n_cx = (int)((x_max - x_min)/cutoff) + 1;
+	int n_cy = (int)((y_max - y_min)/cutoff) + 1;
+	vector<int> cell_start(n_cx*n_cy + 1, 0), cell_items(n2), spot_cell(n2);
+	for(int b=0;b<n2;b++)
+	{
+		int cx = (int)((spots2.x[b] - x_min)/cutoff);
+		int cy = (int)((spots2.y[b] - y_min)/cutoff);
+		spot_cell[b] = cx*n_cy + cy;
+		cell_start[spot_cell[b]+1]++;
+	}
+	for(int c=0;c<n_cx*n_cy;c++)
+		cell_start[c+1] += cell_start[c];
+	vector<int> cell_fill(cell_start.begin(), cell_start.end()-1);
+	for(int b=0;b<n2;b++)   //spots in increasing order inside each cell
+		cell_items[cell_fill[spot_cell[b]]++] = b;
+
+	long int pair_tests = 0;
+	vector<int> hits;   //partners of one spot
+	vector<long int> nucleon_pairs;   //nucleon pairs with a spot-spot collision
+	for(int a=0;a<n1;a++)
+	{
+		double xa = spots1.x[a], ya = spots1.y[a];
+		int cx = (int)floor((xa - x_min)/cutoff);
+		int cy = (int)floor((ya - y_min)/cutoff);
+		hits.clear();
+		for(int ix=max(cx-1, 0);ix<=min(cx+1, n_cx-1);ix++)
+			for(int iy=max(cy-1, 0);iy<=min(cy+1, n_cy-1);iy++)
+			{
+				int c = ix*n_cy + iy;
+				for(int k=cell_start[c];k<cell_start[c+1];k++)
+				{
+					int b = cell_items[k];
+					double b2 = (xa - spots2.x[b])*(xa - spots2.x[b])
+					          + (ya - spots2.y[b])*(ya - spots2.y[b]);
+					pair_tests++;
+					if(b2 <= cutoff2
+					   && (black_disk || nextUniform() < collisionProbability(b2, spot_diameter)))
+						hits.push_back(b);
+				}
+			}
+		sort(hits.begin(), hits.end());
+
+		for(int k=0;k<(int)hits.size();k++)
+		{
+			int b = hits[k];
+			spots1.n_coll[a]++;
+			spots2.n_coll[b]++;
+			Nuc1->setNucleonBinaryCollision(spots1.nucleon[a]);
+			Nuc2->setNucleonBinaryCollision(spots2.nucleon[b]);
+			nucleon_pairs.push_back((long int)spots1.nucleon[a]*atom_num2 + spots2.nucleon[b]);
+			bc_coordinates.push_back(new Coordinates((xa + spots2.x[b])/2., (ya + spots2.y[b])/2.));
+		}
+	}
+	MCG_COUNT(CNT_PAIR_TESTS, pair_tests);
+	MCG_COUNT(CNT_HITS, (long int)bc_coordinates.size());
+
+	if(bc_coordinates.size() == 0 && verbose)
+		cout << "No binary collsion!" << endl;
+
+	//wounded spots are the other kind of source
+	for(int a=0;a<n1;a++)
+		if(spots1.n_coll[a] > 0)
+		{
+			wn_coordinates.push_back(new Coordinates(spots1.x[a], spots1.y[a]));
+			wn_nucleus.push_back(1);
+		}
+	for(int b=0;b<n2;b++)
+		if(spots2.n_coll[b] > 0)
+		{
+			wn_coordinates.push_back(new Coordinates(spots2.x[b], spots2.y[b]));
+			wn_nucleus.push_back(2);
+		}
+
+	sort(nucleon_pairs.begin(), nucleon_pairs.end());
+	ncoll = unique(nucleon_pairs.begin(), nucleon_pairs.end()) - nucleon_pairs.begin();
+	npart = 0;
+	for(int i=0;i<atom_num;i++)
+		if(Nuc1->getNucleonBCNum(i) > 0)
+			npart++;
+	for(int j=0;j<atom_num2;j++)
+		if(Nuc2->getNucleonBCNum(j) > 0)
+			npart++;
+	if(verbose)
+		cout << "Number of participants: " << npart << endl
+			 << "Total binary collision: " << ncoll
+			 << " (" << bc_coordinates.size() << " between hot spots)" << endl;
+	drawSourceWeights();
+}
+
+void mc_glauber::findActiveWindow()
+{
+	findWindow(sd_tbl_lower, sd_tbl_lower, sd_tbl_step, max_sd_tbl, max_sd_tbl,
+		&win_i_min, &win_i_max, &win_j_min, &win_j_max);
 }
 
+void mc_glauber::findWindow(double x_lower, double y_lower, double step, int nx, int ny,
+	int* i_min, int* i_max, int* j_min, int* j_max)
+{
+/*
+find the cells that can receive entropy: the bounding box of all wounded
+nucleons and binary collisions, widened by glauber_entropy_width. All grid
+passes only run over this window, cells outside of it stay zero.
+*/
+	double x_min=x_lower+(nx-1)*step, x_max=x_lower;
+	double y_min=y_lower+(ny-1)*step, y_max=y_lower;
+	for(int k=0;k<(int)wn_coordinates.size();k++)
+	{
+		double x = wn_coordinates[k]->getX();
+		double y = wn_coordinates[k]->getY();
+		x_min = min(x_min, x); x_max = max(x_max, x);
+		y_min = min(y_min, y); y_max = max(y_max, y);
+	}
+	for(int k=0;k<(int)bc_coordinates.size();k++)
+	{
+		double x = bc_coordinates[k]->getX();
+		double y = bc_coordinates[k]->getY();
+		x_min = min(x_min, x); x_max = max(x_max, x);
+		y_min = min(y_min, y); y_max = max(y_max, y);
+	}
+
+	*i_min = max(0, (int)floor((x_min - glauber_entropy_width - x_lower)/step));
+	*i_max = min(nx-1, (int)ceil((x_max + glauber_entropy_width - x_lower)/step));
+	*j_min = max(0, (int)floor((y_min - glauber_entropy_width - y_lower)/step));
+	*j_max = min(ny-1, (int)ceil((y_max + glauber_entropy_width - y_lower)/step));
+	if(*i_min > *i_max || *j_min > *j_max)  //all sources outside of the table
+	{
+		*i_min = 0; *i_max = -1;
+		*j_min = 0; *j_max = -1;
+	}
+}
+
+
 void mc_glauber::distEntropy()
 {
 /*
@@ -190,53 +863,130 @@ the same. Normalization needs to be fit by multiplicity, so it is
 not done in this function
 */
 //	cout << "start to distribute entropy" << endl;
+	MCG_TIMER(TMR_DEPOSIT);
+	MCG_COUNT(CNT_CELLS, (long int)(win_i_max-win_i_min+1)*(win_j_max-win_j_min+1));
+	forgetMoments();
 	//initialize entropy density table
-	entropy_density = new double* [max_sd_tbl];
-	for(int i=0;i<max_sd_tbl;i++)
+	if(entropy_density == 0)
+		entropy_density = new SdTable(max_sd_tbl, max_sd_tbl,
+			sd_tbl_lower, sd_tbl_lower, sd_tbl_step);
+	else   //reuse the buffer
+		entropy_density->resize(max_sd_tbl, max_sd_tbl,
+			sd_tbl_lower, sd_tbl_lower, sd_tbl_step);
+
+	depositSources(entropy_density, win_i_min, win_i_max, win_j_min, win_j_max);
+	sd_valid = true;
+	if(verbose)
 	{
-		entropy_density[i] = new double [max_sd_tbl];
-		for(int j=0;j<max_sd_tbl;j++)
-			entropy_density[i][j] = 0.;		
+		cout << "Entropy profile is generated!" << endl;
+		if(normalization == 0)
+			cout << "Tips: fit to final multiplicity before put it into hydro!" << endl;
+		cout << endl;
 	}
+}
 
-	for(int i=0;i<max_sd_tbl;i++)
-		for(int j=0;j<max_sd_tbl;j++)
-		{
-			double x_tbl = sd_tbl_lower + i*sd_tbl_step;
-			double y_tbl = sd_tbl_lower + j*sd_tbl_step;
-
-			//find contribution from wounded nucleons
-			for(int k=0;k<(int)wn_coordinates.size();k++)
-			{
-				double wn_x = wn_coordinates[k]->getX();
-				double wn_y = wn_coordinates[k]->getY();
-
-				double distance = sqrt((x_tbl - wn_x)*(x_tbl - wn_x)
-						   +(y_tbl - wn_y)*(y_tbl - wn_y));
-				if(distance <= glauber_entropy_width)
-					entropy_density[i][j]+=alpha;
-			}
 
-			//find contribution from binary collisions
-			for(int k=0;k<(int)bc_coordinates.size();k++)
-			{
-				double bc_x = bc_coordinates[k]->getX();
-				double bc_y = bc_coordinates[k]->getY();
+void mc_glauber::depositSources(SdTable* table, int i_min, int i_max, int j_min, int j_max)
+{
+/*
+scatter every source onto the cells around it within the window; each
+cell still receives the wounded nucleons first and then the binary
+collisions, both in order, so the sums are those of a loop over cells
+that visits all sources, at a cost that does not grow with the window
+*/
+	int n_wn = wn_coordinates.size();
+	int n_sources = n_wn + bc_coordinates.size();
+	for(int k=0;k<n_sources;k++)
+	{
+		Coordinates* source = (k < n_wn) ? wn_coordinates[k] : bc_coordinates[k-n_wn];
+		depositDisk(table, source->getX(), source->getY(),
+			(k < n_wn) ? wn_weight[k] : bc_weight[k-n_wn], i_min, i_max, j_min, j_max);
+	}
+}
 
-				double distance = sqrt((x_tbl - bc_x)*(x_tbl - bc_x)
-						   +(y_tbl - bc_y)*(y_tbl - bc_y));
-				if(distance <= glauber_entropy_width)
-					entropy_density[i][j]+=(1.-alpha);
-			}
+void mc_glauber::depositDisk(SdTable* table, double s_x, double s_y, double weight,
+	int i_min, int i_max, int j_min, int j_max)
+{
+	double step = table->getStep();
+	double x_lower = table->getX(0), y_lower = table->getY(0);
+	if(!generic_kernels && x_lower == y_lower
+	   && table->getNx() == table->getNy())   //compiled kernels, see SdKernels.h
+	{
+		if(!runtime_grid && ProductionGrid::matches(*table))
+			depositKernel(*table, ProductionGrid(), glauber_entropy_width,
+				s_x, s_y, weight, i_min, i_max, j_min, j_max);
+		else
+			depositKernel(*table, RuntimeGrid(table->getNx(), x_lower, step),
+				glauber_entropy_width, s_x, s_y, weight, i_min, i_max, j_min, j_max);
+		return;
+	}
+	int i_a = max(i_min, (int)floor((s_x - glauber_entropy_width - x_lower)/step));
+	int i_b = min(i_max, (int)ceil((s_x + glauber_entropy_width - x_lower)/step));
+	int j_a = max(j_min, (int)floor((s_y - glauber_entropy_width - y_lower)/step));
+	int j_b = min(j_max, (int)ceil((s_y + glauber_entropy_width - y_lower)/step));
+	for(int i=i_a;i<=i_b;i++)
+	{
+		sd_real* sd_row = table->row(i);
+		double x_tbl = table->getX(i);
+		for(int j=j_a;j<=j_b;j++)
+		{
+			double y_tbl = table->getY(j);
+			double distance = sqrt((x_tbl - s_x)*(x_tbl - s_x)
+					   +(y_tbl - s_y)*(y_tbl - s_y));
+			if(distance <= glauber_entropy_width)
+				sd_row[j]+=weight;
 		}
-	cout << "Entropy profile is generated!" << endl
-	     << "Tips: fit to final multiplicity before put it into hydro!"
-	     << endl << endl;
+	}
 }
 
+void mc_glauber::resample(SdTable* table, double step)
+{
+/*
+the entropy density of this event on the range of the table at another
+step: the deposited table averaged over blocks of cells if step is an odd
+multiple of sd_tbl_step (the cells stay centred on the same points)
+and the table was deposited for this event, otherwise deposited anew
+from the sources, e.g. for finer grids or without a table
+*/
+	if(!(step > 0.) || (sd_tbl_upper-sd_tbl_lower)/step > 1e5)
+	{
+		cout << "Cannot resample the table at step " << step
+		     << ", need step > 0 and at most 1e5 cells per side! Exit..." << endl;
+		exit(-1);
+	}
+	MCG_TIMER(TMR_DEPOSIT);
+	int factor = (int)(step/sd_tbl_step+0.5);
+	if(sd_valid && factor%2 == 1 && fabs(factor*sd_tbl_step-step) < 1e-6*step)
+	{
+		table->downsample(*entropy_density, factor);
+		return;
+	}
+	int n = (int)((sd_tbl_upper-sd_tbl_lower)/step+0.1)+1;
+	table->resize(n, n, sd_tbl_lower, sd_tbl_lower, step);
+	int i_min, i_max, j_min, j_max;
+	findWindow(sd_tbl_lower, sd_tbl_lower, step, n, n, &i_min, &i_max, &j_min, &j_max);
+	depositSources(table, i_min, i_max, j_min, j_max);
+}
 
-void mc_glauber::dumpSdTable(string filename)
+void mc_glauber::dumpSdTable(string filename, bool window_only)
 {
+    ofstream of;
+    of.open(filename.c_str(), std::ios_base::out);
+    writeSdTable(of, window_only);
+    MCG_COUNT(CNT_BYTES_WRITTEN, (long int)of.tellp());
+    of.close();
+    if(verbose)
+    {
+        cout << "entropy density table dumped to file: "
+             << filename << endl;
+        cout << "Run Matlab script sd_plot.m to see the entropy density profile" << endl;
+    }
+
+}
+
+void mc_glauber::writeSdTable(ostream& of, bool window_only)
+{
+	MCG_TIMER(TMR_FORMAT);
 	//safety check
 	if(entropy_density == 0)
     {
@@ -244,27 +994,177 @@ void mc_glauber::dumpSdTable(string filename)
     	exit(0);
     }
 
-    ofstream of;
-    of.open(filename.c_str(), std::ios_base::out);
-    of << "% x, y from: " << sd_tbl_lower << " to " << sd_tbl_upper
-       << ", with step: " << sd_tbl_step <<endl;
+    int i_min=0, i_max=max_sd_tbl-1, j_min=0, j_max=max_sd_tbl-1;
+    if(window_only)  //peripheral events: skip the empty border
+    {
+    	i_min = win_i_min; i_max = win_i_max;
+    	j_min = win_j_min; j_max = win_j_max;
+    	of << "% x from: " << sd_tbl_lower + i_min*sd_tbl_step
+    	   << " to " << sd_tbl_lower + i_max*sd_tbl_step
+    	   << ", y from: " << sd_tbl_lower + j_min*sd_tbl_step
+    	   << " to " << sd_tbl_lower + j_max*sd_tbl_step
+    	   << ", with step: " << sd_tbl_step << endl;
+    }
+    else
+    	of << "% x, y from: " << sd_tbl_lower << " to " << sd_tbl_upper
+    	   << ", with step: " << sd_tbl_step <<endl;
 
     of << "% # of wounded nucleons: "<< (int)wn_coordinates.size()
        << "; # of binary collisions: "<< (int)bc_coordinates.size()
        << endl;
+    writeAlignment(of);
 
-    for(int i=0;i<max_sd_tbl;i++)
+    for(int i=i_min;i<=i_max;i++)
     {
-    	for(int j=0;j<max_sd_tbl;j++)
+    	const sd_real* sd_row = entropy_density->row(i);
+    	for(int j=j_min;j<=j_max;j++)
     	{
-    		of << setw(16) << setprecision(8) << entropy_density[i][j];
+    		of << setw(16) << setprecision(8) << sd_row[j];
     	}
     	of << endl;
     }
-    cout << "entropy density table dumped to file: "
-         << filename << endl;
-    cout << "Run Matlab script sd_plot.m to see the entropy density profile" << endl;
+}
+
+void mc_glauber::dumpSdTableSparse(string filename)
+{
+    ofstream of;
+    of.open(filename.c_str(), std::ios_base::out);
+    writeSdTableSparse(of);
+    MCG_COUNT(CNT_BYTES_WRITTEN, (long int)of.tellp());
+    of.close();
+    if(verbose)
+        cout << "sparse entropy density table dumped to file: "
+             << filename << endl;
+}
+
+void mc_glauber::writeSdTableSparse(ostream& of)
+{
+	MCG_TIMER(TMR_FORMAT);
+	//safety check
+	if(entropy_density == 0)
+    {
+    	cout << "No entropy density table" << endl;
+    	exit(0);
+    }
+
+    of << "% sparse entropy density table, read back with SdTable::readSparse()" << endl;
+    of << "% # of wounded nucleons: "<< (int)wn_coordinates.size()
+       << "; # of binary collisions: "<< (int)bc_coordinates.size()
+       << endl;
+    writeAlignment(of);
+    entropy_density->writeSparse(of);
+}
+
+void mc_glauber::dumpSd3D(string filename, double eta_max, double eta_step)
+{
+/*
+the three kinds of sources are deposited once, on the grid of the table;
+every slab is their sum weighted by longitudinalProfile() at its eta_s,
+converted to float and written before the next one is made
+*/
+	MCG_TIMER(TMR_FORMAT);
+	if(!(eta_step > 0.) || !(eta_max >= 0.))
+	{
+		cout << "Bad eta_s range: eta_max=" << eta_max << ", eta_step=" << eta_step
+		     << ", need eta_max >= 0 and eta_step > 0! Exit..." << endl;
+		exit(-1);
+	}
+	int i_min, i_max, j_min, j_max;
+	findWindow(sd_tbl_lower, sd_tbl_lower, sd_tbl_step, max_sd_tbl, max_sd_tbl,
+		&i_min, &i_max, &j_min, &j_max);
+	for(int k=0;k<3;k++)
+	{
+		if(sd_parts[k] == 0)
+			sd_parts[k] = new SdTable();
+		sd_parts[k]->resize(max_sd_tbl, max_sd_tbl, sd_tbl_lower, sd_tbl_lower, sd_tbl_step);
+	}
+	for(int k=0;k<(int)wn_coordinates.size();k++)
+		depositDisk(sd_parts[wn_nucleus[k]], wn_coordinates[k]->getX(),
+			wn_coordinates[k]->getY(), wn_weight[k], i_min, i_max, j_min, j_max);
+	for(int k=0;k<(int)bc_coordinates.size();k++)
+		depositDisk(sd_parts[0], bc_coordinates[k]->getX(), bc_coordinates[k]->getY(),
+			bc_weight[k], i_min, i_max, j_min, j_max);
+
+	FILE* out = fopen(filename.c_str(), "wb");
+	if(out == 0)
+	{
+		cout << "Cannot open " << filename << "! Exit..." << endl;
+		exit(-1);
+	}
+	int32_t header_ints[4] = {max_sd_tbl, max_sd_tbl,
+		(int32_t)(2.*eta_max/eta_step+0.1)+1, 0};
+	double header_doubles[5] = {sd_tbl_lower, sd_tbl_lower, sd_tbl_step, -eta_max, eta_step};
+	bool written = fwrite(sd_3d_magic, 1, 8, out) == 8
+		&& fwrite(header_ints, sizeof(int32_t), 4, out) == 4
+		&& fwrite(header_doubles, sizeof(double), 5, out) == 5;
+
+	vector<float> slab((long int)max_sd_tbl*max_sd_tbl, 0.f);   //zero outside the window
+	for(int e=0;e<header_ints[2];e++)
+	{
+		double eta = -eta_max + e*eta_step;
+		double f_bc = longitudinalProfile(0, eta);
+		double f_1 = longitudinalProfile(1, eta);
+		double f_2 = longitudinalProfile(2, eta);
+		for(int i=i_min;i<=i_max;i++)
+		{
+			const sd_real* bc_row = sd_parts[0]->row(i);
+			const sd_real* row_1 = sd_parts[1]->row(i);
+			const sd_real* row_2 = sd_parts[2]->row(i);
+			float* slab_row = &slab[(long int)i*max_sd_tbl];
+			for(int j=j_min;j<=j_max;j++)
+				slab_row[j] = (float)(f_bc*bc_row[j] + f_1*row_1[j] + f_2*row_2[j]);
+		}
+		written = written && fwrite(&slab[0], sizeof(float), slab.size(), out) == slab.size();
+	}
+	MCG_COUNT(CNT_BYTES_WRITTEN, ftell(out));
+	if(fclose(out) != 0 || !written)
+	{
+		cout << "Cannot write " << filename << "! Exit..." << endl;
+		exit(-1);
+	}
+}
+
+void mc_glauber::writeSdTable(ostream& of, const SdTable& table)
+{
+	MCG_TIMER(TMR_FORMAT);
+	of << "% x, y from: " << table.getX(0) << " to " << table.getX(table.getNx()-1)
+	   << ", with step: " << table.getStep() << endl;
+	of << "% # of wounded nucleons: "<< (int)wn_coordinates.size()
+	   << "; # of binary collisions: "<< (int)bc_coordinates.size()
+	   << endl;
+	writeAlignment(of);
+	for(int i=0;i<table.getNx();i++)
+	{
+		for(int j=0;j<table.getNy();j++)
+			of << setw(16) << setprecision(8) << table.get(i, j);
+		of << endl;
+	}
+}
+
+void mc_glauber::writeSdTableSparse(ostream& of, const SdTable& table)
+{
+	MCG_TIMER(TMR_FORMAT);
+	of << "% sparse entropy density table, read back with SdTable::readSparse()" << endl;
+	of << "% # of wounded nucleons: "<< (int)wn_coordinates.size()
+	   << "; # of binary collisions: "<< (int)bc_coordinates.size()
+	   << endl;
+	writeAlignment(of);
+	table.writeSparse(of);
+}
+
+void mc_glauber::writeAlignment(ostream& of)
+{
+	if(align_order > 0)
+		of << "% recentred by (" << align_x << ", " << align_y << "), rotated by -Psi_"
+		   << align_order << " = " << -align_psi << endl;
+}
 
+void mc_glauber::writeNucleonsCoordinates(ostream& of)
+{
+	of << "% nucleus 1: x, y, z" << endl;
+	Nuc1->writeNucleonsCoordinates(of);
+	of << "% nucleus 2: x, y, z" << endl;
+	Nuc2->writeNucleonsCoordinates(of);
 }
 
 void mc_glauber::findSdCM(double* xcm, double* ycm)
@@ -272,30 +1172,76 @@ void mc_glauber::findSdCM(double* xcm, double* ycm)
 /*find the weighted center of the profile, now use entropy density
 as weighting function: xcm=(\int dxdy sd*x)/(\int dxdy sd) 
 */
+    if(!deposit_entropy)
+    {
+    	findSourceCM(xcm, ycm);
+    	return;
+    }
+    if(cm_valid && !generic_kernels)   //same table as the last call
+    {
+    	*xcm = cm_x;
+    	*ycm = cm_y;
+    	return;
+    }
+    MCG_TIMER(TMR_MOMENTS);
+    MCG_COUNT(CNT_CELLS, (long int)(win_i_max-win_i_min+1)*(win_j_max-win_j_min+1));
     double x_ave=0., y_ave=0.;
     double weight=0.;    //use entropy density as weight
     double sd_total=0.;
-    for(int i=0;i<max_sd_tbl;i++)
-		for(int j=0;j<max_sd_tbl;j++)
+    for(int i=win_i_min;i<=win_i_max;i++)
+    {
+		const sd_real* sd_row = entropy_density->row(i);
+		for(int j=win_j_min;j<=win_j_max;j++)
 		{
-			double x= sd_tbl_lower + i*sd_tbl_step;
-			double y= sd_tbl_lower + j*sd_tbl_step;
-			weight = entropy_density[i][j];
+			double x= sd_coord[i];
+			double y= sd_coord[j];
+			weight = sd_row[j];
 			sd_total+=weight*sd_tbl_step*sd_tbl_step;  //total entropy
 
 			x_ave+= weight*x*sd_tbl_step*sd_tbl_step;
 			y_ave+= weight*y*sd_tbl_step*sd_tbl_step;
 		}
+    }
 	*xcm = x_ave/(sd_total + 1e-18);
 	*ycm = y_ave/(sd_total + 1e-18);
+	total_entropy = sd_total;
+	cm_x = *xcm;
+	cm_y = *ycm;
+	cm_valid = true;
 }
 
 
-double mc_glauber::getEccentricity(int order)
+void mc_glauber::sweepMoments(double x_cm, double y_cm)
 {
 /*
-Get the eccentricity of the profile at various order
+everything fillEventSummary() needs around the center in one pass over
+the window (fusedMoments() of SdKernels.h), instead of one pass for
+<r^2> and two per order; kept until the table changes
 */
+	MCG_TIMER(TMR_MOMENTS);
+	MCG_COUNT(CNT_CELLS, (long int)(win_i_max-win_i_min+1)*(win_j_max-win_j_min+1));
+	if(!runtime_grid && ProductionGrid::matches(*entropy_density))
+		fusedMoments<SUMMARY_ORDERS>(*entropy_density, ProductionGrid(),
+			win_i_min, win_i_max, win_j_min, win_j_max, x_cm, y_cm,
+			&moment_r2, moment_real, moment_img, moment_dn);
+	else   //the table is always square
+		fusedMoments<SUMMARY_ORDERS>(*entropy_density,
+			RuntimeGrid(max_sd_tbl, sd_tbl_lower, sd_tbl_step),
+			win_i_min, win_i_max, win_j_min, win_j_max, x_cm, y_cm,
+			&moment_r2, moment_real, moment_img, moment_dn);
+	moments_valid = true;
+}
+
+
+double mc_glauber::getEccentricity(int order, double* psi)
+{
+/*
+Get the eccentricity of the profile at various order. If psi is given,
+it receives the participant plane angle
+Psi_n = (atan2(<r^n sin(n phi)>, <r^n cos(n phi)>) + pi)/n
+*/
+	if(!deposit_entropy)
+		return getSourceEccentricity(order, psi);
 	double x_cm, y_cm;
 	double ecc = 0.;
 	double ecc_nu_real = 0.;
@@ -303,20 +1249,34 @@ Get the eccentricity of the profile at various order
 	double ecc_dn = 0.;
 
 	findSdCM(&x_cm, &y_cm);
+	bool fused = !generic_kernels && order >= 2 && order < 2+SUMMARY_ORDERS;
+	if(fused && !moments_valid)
+		sweepMoments(x_cm, y_cm);
+	MCG_TIMER(TMR_MOMENTS);
 	//debug
-	cout << "Current profile centered at: "
-	     << "x=" << x_cm << ", "
-	     << "y=" << y_cm << endl;
+	if(verbose)
+		cout << "Current profile centered at: "
+		     << "x=" << x_cm << ", "
+		     << "y=" << y_cm << endl;
   
-    for(int i=0; i<max_sd_tbl; i++)
+    if(fused)   //from the sweep of all orders
+    {
+        ecc_nu_real = moment_real[order-2];
+        ecc_nu_img = moment_img[order-2];
+        ecc_dn = moment_dn[order-2];
+    }
+    else
+        MCG_COUNT(CNT_CELLS, (long int)(win_i_max-win_i_min+1)*(win_j_max-win_j_min+1));
+    for(int i=win_i_min; i<=win_i_max && !fused; i++)
     {
-        for(int j=0; j<max_sd_tbl; j++)
+        const sd_real* sd_row = entropy_density->row(i);
+        for(int j=win_j_min; j<=win_j_max; j++)
         {
             double x = sd_tbl_lower + sd_tbl_step*i - x_cm;  //recenter the profile
             double y = sd_tbl_lower + sd_tbl_step*j - y_cm;
             double phi = atan2(y,x);
 
-            double sd = entropy_density[i][j];
+            double sd = sd_row[j];
 
             ecc_nu_real += pow(x*x + y*y, double(order)/2.) 
                   * cos(order * phi) * sd * sd_tbl_step * sd_tbl_step;
@@ -330,8 +1290,235 @@ Get the eccentricity of the profile at various order
     ecc = sqrt( ecc_nu_real * ecc_nu_real + ecc_nu_img * ecc_nu_img )
        /(ecc_dn + 1e-18);
 
-    cout << "Spatial Eccentricity at " << order << "th order is: "
-         << ecc << endl;
+    if(verbose)
+        cout << "Spatial Eccentricity at " << order << "th order is: "
+             << ecc << endl;
+    if(psi)
+    {
+        *psi = wrapPsi((atan2(ecc_nu_img, ecc_nu_real) + M_PI)/order, order);
+    }
+
+	return ecc;
+}
+
+
+void mc_glauber::fillEventSummary(EventSummary* summary)
+{
+/*
+collect the per-event quantities: centrality estimators, center of the
+profile, total entropy, <r^2> around the center, eccentricities and
+participant plane angles at orders 2 ~ SUMMARY_ORDERS+1
+*/
+	double x_cm, y_cm;
+	findSdCM(&x_cm, &y_cm);
+
+	double r2 = 0.;
+	if(deposit_entropy && !generic_kernels)
+	{
+		if(!moments_valid)
+			sweepMoments(x_cm, y_cm);
+		r2 = moment_r2;
+	}
+	else if(deposit_entropy)
+	{
+		for(int i=win_i_min;i<=win_i_max;i++)
+		{
+			const sd_real* sd_row = entropy_density->row(i);
+			double x = sd_tbl_lower + i*sd_tbl_step - x_cm;
+			for(int j=win_j_min;j<=win_j_max;j++)
+			{
+				double y = sd_tbl_lower + j*sd_tbl_step - y_cm;
+				r2 += sd_row[j]*(x*x + y*y)*sd_tbl_step*sd_tbl_step;
+			}
+		}
+	}
+	else
+		r2 = getSourceR2(x_cm, y_cm)*total_entropy;
+
+	summary->b = impact_parameter;
+	summary->npart = npart;
+	summary->ncoll = ncoll;
+	summary->x_cm = x_cm;
+	summary->y_cm = y_cm;
+	summary->sd_total = total_entropy;
+	summary->r2 = r2/(total_entropy + 1e-18);
+	for(int n=0;n<SUMMARY_ORDERS;n++)
+		summary->ecc[n] = getEccentricity(n+2, &summary->psi[n]);
+}
+
+
+void mc_glauber::fillSourceList(SourceList* sources)
+{
+/*
+the wounded sources in the order of wn_coordinates (and wn_weight):
+hot spots of nucleus 1 then nucleus 2, or nucleons of both nuclei
+interleaved as in findCollisions()
+*/
+	sources->b = impact_parameter;
+	sources->wounded.clear();
+	sources->binary.clear();
+	for(int n=1;n<=2 && n_spots>0;n++)   //wounded hot spots, index of their nucleon
+	{
+		HotSpots& spots = (n == 1) ? spots1 : spots2;
+		for(int a=0;a<(int)spots.x.size();a++)
+		{
+			if(spots.n_coll[a] == 0)
+				continue;
+			WoundedSource source;
+			source.x = spots.x[a];
+			source.y = spots.y[a];
+			source.nucleus = n;
+			source.n_coll = spots.n_coll[a];
+			source.index = spots.nucleon[a];
+			sources->wounded.push_back(source);
+		}
+	}
+	for(int i=0;i<max(atom_num, atom_num2) && n_spots==0;i++)
+		for(int n=1;n<=2;n++)
+		{
+			Nucleus* nucleus = (n == 1) ? Nuc1 : Nuc2;
+			if(i >= ((n == 1) ? atom_num : atom_num2) || nucleus->getNucleonBCNum(i) == 0)
+				continue;
+			double x, y, z;
+			nucleus->getNucleonCoordinates(i, &x, &y, &z);
+			WoundedSource source;
+			source.x = x;
+			source.y = y;
+			source.nucleus = n;
+			source.n_coll = nucleus->getNucleonBCNum(i);
+			source.index = i;
+			sources->wounded.push_back(source);
+		}
+	for(int k=0;k<(int)sources->wounded.size();k++)
+		sources->wounded[k].weight = wn_weight[k];
+
+	sources->binary.resize(bc_coordinates.size());
+	for(int k=0;k<(int)bc_coordinates.size();k++)
+	{
+		sources->binary[k].x = bc_coordinates[k]->getX();
+		sources->binary[k].y = bc_coordinates[k]->getY();
+		sources->binary[k].weight = bc_weight[k];
+	}
+}
+
+
+/*
+Moments without the table: every source spreads its weight (wn_weight for a
+wounded nucleon, bc_weight for a binary collision) uniformly over a disk of
+radius R = glauber_entropy_width around its position a. With u uniform
+on the disk, the averages over one disk are
+  <a+u> = a,   <(a+u)^n> = a^n   (complex, all powers of u average out),
+  <|a+u|^2m> = sum_k C(m,k)^2 |a|^2(m-k) R^2k/(k+1),
+so the center, the numerators and the even denominators are exact; odd
+denominators <|a+u|^n> are averaged on a polar grid over the disk.
+*/
+static double diskMoment(double a2, double R, int order)
+{
+	if(order%2 == 0)
+	{
+		int m = order/2;
+		double sum = 0., binomial = 1.;
+		for(int k=0;k<=m;k++)
+		{
+			sum += binomial*binomial*pow(a2, m-k)*pow(R*R, k)/(k+1.);
+			binomial *= double(m-k)/(k+1.);
+		}
+		return sum;
+	}
+	const int n_rho = 8, n_theta = 16;   //rho^2 uniform, theta in [0, pi] by symmetry
+	double a = sqrt(a2), sum = 0.;
+	for(int i=0;i<n_rho;i++)
+	{
+		double rho = R*sqrt((i+0.5)/n_rho);
+		for(int j=0;j<n_theta;j++)
+		{
+			double theta = (j+0.5)*M_PI/n_theta;
+			double d2 = a2 + rho*rho + 2.*a*rho*cos(theta);
+			sum += pow(d2, 0.5*order);
+		}
+	}
+	return sum/(n_rho*n_theta);
+}
+
+void mc_glauber::findSourceCM(double* xcm, double* ycm)
+{
+	MCG_TIMER(TMR_MOMENTS);
+	double x_ave = 0., y_ave = 0., weight = 0.;
+	for(int k=0;k<(int)wn_coordinates.size();k++)
+	{
+		x_ave += wn_weight[k]*wn_coordinates[k]->getX();
+		y_ave += wn_weight[k]*wn_coordinates[k]->getY();
+		weight += wn_weight[k];
+	}
+	for(int k=0;k<(int)bc_coordinates.size();k++)
+	{
+		x_ave += bc_weight[k]*bc_coordinates[k]->getX();
+		y_ave += bc_weight[k]*bc_coordinates[k]->getY();
+		weight += bc_weight[k];
+	}
+	*xcm = x_ave/(weight + 1e-18);
+	*ycm = y_ave/(weight + 1e-18);
+	total_entropy = weight*M_PI*glauber_entropy_width*glauber_entropy_width;
+}
 
+double mc_glauber::getSourceR2(double x_cm, double y_cm)
+{
+	double r2 = 0., weight = 0.;
+	for(int k=0;k<(int)wn_coordinates.size()+(int)bc_coordinates.size();k++)
+	{
+		bool wounded = k < (int)wn_coordinates.size();
+		Coordinates* source = wounded ? wn_coordinates[k] : bc_coordinates[k-wn_coordinates.size()];
+		double w = wounded ? wn_weight[k] : bc_weight[k-wn_coordinates.size()];
+		double x = source->getX() - x_cm, y = source->getY() - y_cm;
+		r2 += w*diskMoment(x*x + y*y, glauber_entropy_width, 2);
+		weight += w;
+	}
+	return r2/(weight + 1e-18);
+}
+
+void mc_glauber::findSourceEccentricity(int order, double* ecc, double* psi)
+{
+	double x_cm, y_cm;
+	findSourceCM(&x_cm, &y_cm);
+	MCG_TIMER(TMR_MOMENTS);
+	double ecc_nu_real = 0., ecc_nu_img = 0., ecc_dn = 0.;
+	for(int k=0;k<(int)wn_coordinates.size()+(int)bc_coordinates.size();k++)
+	{
+		bool wounded = k < (int)wn_coordinates.size();
+		Coordinates* source = wounded ? wn_coordinates[k] : bc_coordinates[k-wn_coordinates.size()];
+		double w = wounded ? wn_weight[k] : bc_weight[k-wn_coordinates.size()];
+		double x = source->getX() - x_cm, y = source->getY() - y_cm;
+		double r2 = x*x + y*y;
+		double phi = atan2(y, x);
+		double rn = pow(r2, double(order)/2.);
+		ecc_nu_real += w*rn*cos(order*phi);
+		ecc_nu_img += w*rn*sin(order*phi);
+		ecc_dn += w*diskMoment(r2, glauber_entropy_width, order);
+	}
+	*ecc = sqrt(ecc_nu_real*ecc_nu_real + ecc_nu_img*ecc_nu_img)/(ecc_dn + 1e-18);
+	*psi = (atan2(ecc_nu_img, ecc_nu_real) + M_PI)/order;
+}
+
+double mc_glauber::getSourceEccentricity(int order, double* psi)
+{
+	double ecc, psi_n;
+	findSourceEccentricity(order, &ecc, &psi_n);
+	if(verbose)
+		cout << "Spatial Eccentricity at " << order << "th order is: "
+		     << ecc << endl;
+	if(psi)
+		*psi = wrapPsi(psi_n, order);
 	return ecc;
 }
+
+double mc_glauber::wrapPsi(double psi, int order)
+{
+/*
+psi comes in 0 ~ 2pi/n; an aligned event has Psi_n ~ 0, which grid
+noise puts at either end of that range, so with alignment on every
+angle is given in -pi/n ~ pi/n instead
+*/
+	if(align_order > 0 && psi >= M_PI/order)
+		psi -= 2.*M_PI/order;
+	return psi;
+}
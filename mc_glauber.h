@@ -9,37 +9,179 @@
 #include "Coordinates.h"
 #include "Nucleon.h"
 #include "Nucleus.h"
+#include "SdTable.h"
+#include "EventSummary.h"
+#include "SourceList.h"
+#include "Normalization.h"
+#include "Instrument.h"
 
 using namespace std;
 
+//nucleon-nucleon collision probability P(b) at transverse distance b,
+//all with the same cross section sigma = pi*(2*rp)^2 = \int d^2b P(b)
+enum CollisionProfile {
+	COLLISION_BLACK_DISK,   //P = 1 for b <= 2*rp, the original hit()
+	COLLISION_GRAY_DISK,    //P = p0 for b <= sqrt(sigma/(pi*p0))
+	COLLISION_GAUSSIAN      //P = p0*exp(-pi*p0*b^2/sigma)
+};
+
+//constituent hot spots of all nucleons of one nucleus, structure of arrays
+struct HotSpots
+{
+	vector<double> x, y;
+	vector<int> nucleon;   //nucleon the spot belongs to
+	vector<int> n_coll;    //spot-spot collisions of this spot
+
+	void clear() { x.clear(); y.clear(); nucleon.clear(); n_coll.clear(); }
+};
+
 class mc_glauber
 {
+	friend class Benchmark;   //times the protected stages one by one
+
 protected:
 	int atom_num;    //assign atomic number
+	int atom_num2;   //atomic number of the second nucleus
 	double impact_parameter;   //impact parameter for collision
 	double glauber_entropy_width;  //the width of entropy deposited in the fireball
 	double alpha;     //weight for wounded nucleon
 	Nucleus* Nuc1;    //declare two nuclei
 	Nucleus* Nuc2;
 	vector<Coordinates*> wn_coordinates; //coordinates of wounded nucleons
+	vector<int> wn_nucleus;   //nucleus 1 or 2 of each of them
 	vector<Coordinates*> bc_coordinates; //coordinates of binary collision positions
-	double** entropy_density; //table for entropy density: dS/(tau_0d^2rd\eta_s)|\eta_s=0
+	vector<double> wn_weight, bc_weight;  //entropy of each source: alpha, 1-alpha,
+							//times a gamma-distributed factor with weight_shape > 0
+	double weight_shape;  //shape k of the gamma factor (mean 1, variance 1/k), 0: none
+	Normalization* normalization;  //centrality-dependent scale of the entropy, not owned
+	double sd_scale;   //factor applied by normalizeSources() to this event, 1 if none
+	SdTable* entropy_density; //table for entropy density: dS/(tau_0d^2rd\eta_s)|\eta_s=0
+	SdTable* sd_parts[3];   //deposits of the binary collisions and of the wounded
+							//nucleons of nucleus 1 and 2, the slabs of dumpSd3D()
+	bool generic_kernels;   //true: never the compiled kernels of SdKernels.h
+	bool runtime_grid;   //true: never their ProductionGrid version
+	int align_order;   //>0: sources recentred and rotated by Psi_n before deposition
+	double align_x, align_y, align_psi;   //shift and angle applied by alignSources()
+	double y_beam;   //wounded nucleons fall off linearly to |eta_s| = y_beam
+	double eta_plateau, eta_width;   //flat for |eta_s| < eta_plateau, then Gaussian tails
 
 	double sd_tbl_lower, sd_tbl_upper, sd_tbl_step;  //parameters for entropy density table
 	int max_sd_tbl;
+	bool deposit_entropy;   //false: no table, moments come from the sources
+	bool sd_valid;   //entropy_density was deposited for the current event
+	double total_entropy;   //\int dxdy sd, updated by findSdCM()
+	vector<double> sd_coord;   //coordinate of cell i along x and y
+	bool cm_valid, moments_valid;   //the values below are of the current table
+	double cm_x, cm_y;   //center found by findSdCM()
+	double moment_r2;   //\int dxdy sd r^2 around the center
+	double moment_real[SUMMARY_ORDERS], moment_img[SUMMARY_ORDERS],
+		moment_dn[SUMMARY_ORDERS];   //numerators and denominators, orders 2 ~ SUMMARY_ORDERS+1
+	int npart, ncoll;   //number of wounded nucleons and binary collisions
+	int win_i_min, win_i_max, win_j_min, win_j_max;  //active window of the table,
+							//cells outside it are zero
+	int collision_profile;   //CollisionProfile
+	double collision_opacity;   //p0 of the gray and Gaussian profiles, 0 < p0 <= 1
+	unsigned long long collision_rng;   //splitmix64 state for the collision draws
+	bool has_collision_seed;   //false: seed from random_seed() in findCollisions()
+	unsigned long int event_seed;   //from setEventSeed(), to sample again without collision
+	bool has_event_seed;   //cleared by overlap(), like the seeds it sets
+	bool verbose;   //false: print errors and warnings only
+	vector<double> uniform_batch;   //uniforms drawn in bulk for the candidate pairs
+	int uniform_pos;   //next unused element of uniform_batch
+
+	double nextUniform() {
+		if(uniform_pos == (int)uniform_batch.size())
+			refillUniforms();
+		return uniform_batch[uniform_pos++];
+	}
+	void refillUniforms();
+	void sampleGamma(double shape, double* out, int n);   //n gamma(shape, 1) variates
+	void drawSourceWeights();   //wn_weight and bc_weight, end of the collision search
+	void normalizeSources();   //scale the weights, before anything is deposited
+	void alignSources();   //move the center to the origin and Psi_n onto the x axis
+	void writeAlignment(ostream& os);   //comment line of the tables, if aligned
+	double collisionCutoff(double d);   //distance beyond which P(b) is negligible,
+	double collisionProbability(double b2, double d);   //P(b) from b^2, for disks of diameter d
+
+	int n_spots;   //hot spots per nucleon, 0: nucleons without substructure
+	double spot_width;   //Gaussian width of the spot positions around the nucleon
+	double spot_diameter;   //spots collide like nucleons of this diameter
+	HotSpots spots1, spots2;
+	void sampleHotSpots(Nucleus* nucleus, int n_nucleons, HotSpots* spots);
+	void findHotSpotCollisions();   //findCollisions() with substructure
 
+	void clearSources();   //drop the sources of the previous event
+	void findActiveWindow();  //bounding box of all sources plus the entropy width
+	void findWindow(double x_lower, double y_lower, double step, int nx, int ny,
+		int* i_min, int* i_max, int* j_min, int* j_max);  //same for any grid
+	void depositSources(SdTable* table, int i_min, int i_max, int j_min, int j_max);
+							//add the sources to the cells of the window
+	void depositDisk(SdTable* table, double s_x, double s_y, double weight,
+		int i_min, int i_max, int j_min, int j_max);   //one source
 	bool hit(double rp, double x0, double y0, double x1, double y1);   //if the collision happens
+	void generateNuclei();  //sample nucleons and shift the nuclei by the impact parameter
+	void findCollisions();  //find binary collisions and wounded nucleons
 	void distEntropy();     //calculate entropy density in the in the transverse plane
 							//sd = (1-alpha)*wn + alpha*bc
 	void findSdCM(double* xcm, double *ycm);   //find the coordinate of center of entropy density
+	void sweepMoments(double x_cm, double y_cm);   //<r^2> and all summary orders in one pass
+	void forgetMoments() {cm_valid = false; moments_valid = false;}   //the table changed
+	void findSourceCM(double* xcm, double* ycm);   //same from the sources, without the table
+	void findSourceEccentricity(int order, double* ecc, double* psi);   //eccentricity and
+							//participant plane from the sources, prints nothing
+	double getSourceEccentricity(int order, double* psi=0);   //same, printed as getEccentricity()
+	double wrapPsi(double psi, int order);   //-pi/n ~ pi/n with alignment on, else as it is
+	double getSourceR2(double x_cm, double y_cm);   //<r^2> from the sources
 
 public:
 	mc_glauber(int Atom_num, double Impact_parameter, 
-			double Sd_tbl_min, double Sd_tbl_max, double Sd_tbl_step) ;
+			double Sd_tbl_min, double Sd_tbl_max, double Sd_tbl_step,
+			int Atom_num2=0, bool Verbose=true) ;  //Atom_num2=0: both nuclei have Atom_num
 	~mc_glauber() ;
 	void overlap();  //count wounded nucleons and binary collisions
-	void dumpSdTable(string filename);  //dump entropy density table
-	double getEccentricity(int order);   //calculate encentricity at specific order
+	void setEventSeed(unsigned long int seed);  //reproducible event, call before overlap()
+	void setVerbose(bool Verbose);  //false: print errors and warnings only, nuclei included
+	void setCollisionProfile(int Profile, double Opacity=1.);  //see CollisionProfile
+	void setHotSpots(int N_spots, double Spot_width=0.3, double Spot_diameter=0.53,
+		double Entropy_width=0.3);  //N_spots=0: no substructure
+	void setWeightFluctuations(double Shape);  //gamma factor of shape k per source, 0: off
+	void setNormalization(Normalization* Norm) {normalization = Norm;}  //0: unnormalised
+	void setGenericKernels(bool Generic) {generic_kernels = Generic; forgetMoments();}  //for comparisons
+	void setRuntimeGrid(bool Runtime) {runtime_grid = Runtime; forgetMoments();}  //same
+	void setAlignment(int Order) {align_order = Order;}  //0: sources as they collided
+	void getAlignment(double* x_cm, double* y_cm, double* psi) {
+		*x_cm = align_x; *y_cm = align_y; *psi = align_psi;}  //applied by alignSources()
+	void setSpecies(string Species1, string Species2="");  //measured Woods-Saxon parameters,
+							//e.g. "Au197", see NuclearData.h; "": 1.25 A^1/3 fm
+	void setLongitudinalProfile(double Y_beam, double Eta_plateau=1., double Eta_width=1.3);
+	double longitudinalProfile(int nucleus, double eta);  //weight of a wounded nucleon of
+							//nucleus 1 or 2 at eta_s, nucleus 0: binary collision
+	void setDepositEntropy(bool Deposit) {deposit_entropy = Deposit;}  //false: overlap()
+							//skips distEntropy(), only sources and moments are available
+	void setSdBuffer(sd_real* Buffer, long int Capacity);  //deposit into the caller's buffer
+							//of Capacity cells, see SdTable::attach()
+	void dumpSdTable(string filename, bool window_only=false);  //dump entropy density table,
+							//window_only=true dumps the active window only
+	void dumpSdTableSparse(string filename);  //dump only the nonzero cells of the table
+	void writeSdTable(ostream& os, bool window_only=false);  //same as the dumps above,
+	void writeSdTableSparse(ostream& os);                    //but into any stream
+	void resample(SdTable* table, double step);  //this event on the same range at another
+							//step, averaged from the table or deposited anew
+	void writeSdTable(ostream& os, const SdTable& table);  //any table of this event,
+	void writeSdTableSparse(ostream& os, const SdTable& table);  //e.g. from resample()
+	void dumpSd3D(string filename, double eta_max, double eta_step);  //binary 3D table,
+							//-eta_max ~ eta_max, written slab by slab
+	void writeNucleonsCoordinates(ostream& os);  //positions of the nucleons in both nuclei
+	double getEccentricity(int order, double* psi=0);   //calculate encentricity at specific order,
+							//and optionally the participant plane angle
+	void fillEventSummary(EventSummary* summary);  //everything but the event id
+	void fillSourceList(SourceList* sources);  //wounded nucleons and binary collisions
+	double getAlpha() {return alpha;}   //weight of a wounded nucleon
+	double getEntropyWidth() {return glauber_entropy_width;}   //radius of a source
+	double getNormalizationScale() {return sd_scale;}
+	int getNpart() {return npart;}
+	int getNcoll() {return ncoll;}
+	SdTable* getSdTable() {return entropy_density;}  //entropy density table, no copy
 };
 
 #endif
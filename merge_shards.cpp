@@ -0,0 +1,149 @@
+/*
+Programmed by: Jia Liu
+
+Contact information: liu.2053@osu.edu
+
+Code Name: Event-by-Event Monte-Carlo Glauber(MCG) Generator
+
+Purpose: Put together the outputs of a sharded run
+
+A run split over N processes,
+> main --seed s --nevents n --shard k/N      (k = 0 ~ N-1)
+writes every output shared by all events as <name>.shard_<k>_of_<N>.
+Per-event tables (Sd_A_*_event_<i>.dat) are named by the global event
+number and need no merging.
+
+Usage:
+> merge_shards N data/Summary_A_208.bin data/Ecc_A_208_order_2.dat ...
+
+For every name, the pieces of shard 0 ~ N-1 are concatenated in order
+into <name>:
+1. summary tables and source lists (.bin) keep one header, the schema
+   of all pieces must agree;
+2. gzip files are simply concatenated, each frame stays a separate gzip
+   member; the frame index <piece>.idx is renumbered and shifted into
+   <name>.idx;
+3. text files are concatenated.
+<name>.shards records where each piece starts in the merged file:
+shard  offset  bytes
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+//copy the rest of "in" to "out", return the number of bytes
+long int copyBytes(FILE* in, FILE* out)
+{
+	char buffer[1<<16];
+	long int total = 0;
+	size_t n;
+	while((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+	{
+		fwrite(buffer, 1, n, out);
+		total += n;
+	}
+	return total;
+}
+
+bool endsWith(const string& name, const string& tail)
+{
+	return name.size() >= tail.size()
+	    && name.compare(name.size()-tail.size(), tail.size(), tail) == 0;
+}
+
+bool mergeOutput(string name, int n_shards)
+{
+	const int header_size = 16;   //see EventSummary.h and SourceList.h
+	bool is_summary = endsWith(name, ".bin");
+
+	FILE* out = fopen(name.c_str(), "wb");
+	if(out == 0)
+	{
+		cout << "Cannot open " << name << " for writing" << endl;
+		return false;
+	}
+	ofstream shards_of((name + ".shards").c_str());
+	ofstream* idx_of = 0;
+	long int n_frames = 0;
+	char header[header_size], first_header[header_size];
+
+	for(int k=0;k<n_shards;k++)
+	{
+		ostringstream piece_stream;
+		piece_stream << name << ".shard_" << k << "_of_" << n_shards;
+		string piece = piece_stream.str();
+		FILE* in = fopen(piece.c_str(), "rb");
+		if(in == 0)
+		{
+			cout << "Missing piece " << piece << ", merge of " << name << " stopped" << endl;
+			fclose(out);
+			return false;
+		}
+
+		long int offset = ftell(out);
+		if(is_summary)
+		{
+			if(fread(header, 1, header_size, in) != (size_t)header_size)
+			{
+				cout << piece << " has no summary header" << endl;
+				fclose(in);
+				fclose(out);
+				return false;
+			}
+			if(k == 0)
+			{
+				memcpy(first_header, header, header_size);
+				fwrite(header, 1, header_size, out);
+				offset = ftell(out);
+			}
+			else if(memcmp(header, first_header, header_size) != 0)
+			{
+				cout << piece << " was written with a different summary schema" << endl;
+				fclose(in);
+				fclose(out);
+				return false;
+			}
+		}
+		long int bytes = copyBytes(in, out);
+		fclose(in);
+		shards_of << k << " " << offset << " " << bytes << endl;
+
+		//shift the frame index of compressed pieces
+		ifstream piece_idx((piece + ".idx").c_str());
+		if(piece_idx.good())
+		{
+			if(idx_of == 0)
+				idx_of = new ofstream((name + ".idx").c_str());
+			long int frame, frame_offset, stored, raw;
+			while(piece_idx >> frame >> frame_offset >> stored >> raw)
+				*idx_of << n_frames++ << " " << offset + frame_offset << " "
+				        << stored << " " << raw << endl;
+		}
+	}
+	fclose(out);
+	if(idx_of)
+		delete idx_of;
+	cout << "Merged " << n_shards << " shards into " << name << endl;
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3 || atoi(argv[1]) < 1)
+	{
+		cout << "Usage: " << argv[0] << " N output_name [output_name ...]" << endl;
+		return 1;
+	}
+	int n_shards = atoi(argv[1]);
+	bool ok = true;
+	for(int k=2;k<argc;k++)
+		ok = mergeOutput(argv[k], n_shards) && ok;
+	return ok ? 0 : 1;
+}